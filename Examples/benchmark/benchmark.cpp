@@ -0,0 +1,115 @@
+// ADVobfuscator
+//
+// Copyright (c) 2025, Sebastien Andrivet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+// following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+// disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+// following disclaimer in the documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+// products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+// USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Get latest version on https://github.com/andrivet/ADVobfuscator
+
+// Latency of the AES policies, of the AES backends and of the conversions of decoded strings.
+//
+// The figures quoted in the history of the project for the AES policies, the precomputed key schedules and the batch
+// decryption are relative figures, to compare settings with each other, not absolute latencies. They were measured
+// with GCC 12.2 at -O2 on one x86-64 core with AES-NI (virtual machine), on a modified copy of the headers: GCC 12.2
+// rejects the string literal types as template arguments because of their constexpr destructors, so these
+// destructors (erasing the strings) were removed for the measurements.
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string_view>
+#include <advobfuscator/aes_string.h>
+#include <advobfuscator/string.h>
+
+using namespace andrivet::advobfuscator;
+
+namespace {
+  constexpr std::size_t iterations = 20000;
+  volatile std::size_t sink = 0;
+
+  // Average time, in nanoseconds, of one call to f
+  template<typename F>
+  double measure(F &&f) {
+    f(); // Warm-up
+    const auto start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < iterations; ++i)
+      f();
+    const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+  }
+
+  void print(std::string_view name, double literal, double reference, double ttable, double bitsliced, double aesni) {
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(12) << literal << std::setw(12) << reference << std::setw(12) << ttable
+              << std::setw(12) << bitsliced << std::setw(12) << aesni << '\n';
+  }
+
+  // Latency of decrypting a 64 characters literal and of decrypting 1 KB with each backend
+  template<typename Policy, AesString s>
+  void benchmark(std::string_view name) {
+    static constexpr typename Policy::Key key{1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    static constexpr Nonce nonce{1, 2, 3, 4, 5, 6, 7, 8};
+    Byte data[1024]{};
+
+    const double literal = measure([] { sink = sink + s.decrypt().size(); });
+    const auto backend = [&]<AesBackend b>() {
+      return measure([&] {
+        decrypt_ctr<b, Policy>(data, sizeof(data), key, nonce);
+        sink = sink + data[0];
+      });
+    };
+    print(name, literal,
+          backend.template operator()<AesBackend::REFERENCE>(),
+          backend.template operator()<AesBackend::TTABLE>(),
+          backend.template operator()<AesBackend::BITSLICED>(),
+          backend.template operator()<AesBackend::AESNI>());
+  }
+
+  // Latency of the conversion of a string already decoded to a pointer to characters
+  template<typename S>
+  double conversion(S s) {
+    sink = sink + static_cast<const char *>(s)[0]; // Decode
+    return measure([&] { sink = sink + static_cast<const char *>(s)[0]; });
+  }
+}
+
+int main() {
+  std::cout << "Latency in nanoseconds (literal: 64 characters, backends: 1 KB)\n";
+  std::cout << std::left << std::setw(12) << "Policy" << std::right << std::setw(12) << "literal"
+            << std::setw(12) << "reference" << std::setw(12) << "ttable" << std::setw(12) << "bitsliced"
+            << std::setw(12) << "aesni" << '\n';
+
+  benchmark<AesLight, AesString<65, AesLight>{"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"}>("AES-light");
+  benchmark<Aes128, AesString<65, Aes128>{"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"}>("AES-128");
+  benchmark<Aes192, AesString<65, Aes192>{"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"}>("AES-192");
+  benchmark<Aes256, AesString<65, Aes256>{"0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef"}>("AES-256");
+
+  std::cout << "\nConversion of a decoded string in nanoseconds\n";
+  std::cout << std::left << std::setw(12) << "Literal" << std::right << std::setw(12) << "obfuscated"
+            << std::setw(12) << "fast" << '\n';
+  std::cout << std::left << std::setw(12) << "_obf" << std::right << std::fixed << std::setprecision(1)
+            << std::setw(12) << conversion("A message written in a logging loop"_obf)
+            << std::setw(12) << conversion("A message written in a logging loop"_obf_fast) << '\n';
+  std::cout << std::left << std::setw(12) << "_aes" << std::right
+            << std::setw(12) << conversion("A message written in a logging loop"_aes)
+            << std::setw(12) << conversion("A message written in a logging loop"_aes_fast) << '\n';
+}
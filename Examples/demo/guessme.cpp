@@ -33,7 +33,7 @@ using namespace andrivet::advobfuscator;
 int main() {
   std::string guess;
   std::cout << "Guess me if you can: "_obf;
-  if(std::cin >> guess; guess == "C++rocks"_obf.decode())
+  if(std::cin >> guess; guess == "C++rocks"_obf.decode_fixed())
     std::cout << "Congratulations\n"_obf;
   else
     std::cout << "Nope\n"_obf;
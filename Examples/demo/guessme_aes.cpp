@@ -33,7 +33,7 @@ using namespace andrivet::advobfuscator;
 int main() {
   std::string guess;
   std::cout << "Guess me if you can: "_aes;
-  if(std::cin >> guess; guess == "C++rocks"_aes.decrypt())
+  if(std::cin >> guess; guess == "C++rocks"_aes.decrypt_fixed())
     std::cout << "Congratulations\n"_aes;
   else
     std::cout << "Nope\n"_aes;
@@ -61,9 +61,8 @@ void describe(const andrivet::advobfuscator::ObfuscatedString<N> &str, bool raw
   using namespace andrivet::advobfuscator;
   std::cout << "Obfuscated: " << (str.obfuscated_ ? "Yes" : "No") << '\n';
   std::cout << "Algorithms: ";
-  for(unsigned i = 0; i < details::MAX_NB_ALGORITHMS; ++i) {
+  for(std::size_t i = 0; i < str.algos_.size(); ++i) {
     const auto algo = str.algos_[i];
-    if(algo.key_algo() == KeyAlgorithm::IDENTITY && algo.data_algo() == DataAlgorithm::IDENTITY) continue;
     std::cout << "(K="   << static_cast<unsigned>(algo.key());
     std::cout << ", KA="; describe(algo.key_algo());
     std::cout << ", DA="; describe(algo.data_algo());
@@ -80,9 +79,8 @@ template<std::size_t N>
 void describe(const andrivet::advobfuscator::ObfuscatedBytes<N> &block, bool raw = true) {
   using namespace andrivet::advobfuscator;
   std::cout << "Algorithms: ";
-  for(unsigned i = 0; i < details::MAX_NB_ALGORITHMS; ++i) {
+  for(std::size_t i = 0; i < block.algos_.size(); ++i) {
     const auto algo = block.algos_[i];
-    if(algo.key_algo() == KeyAlgorithm::IDENTITY && algo.data_algo() == DataAlgorithm::IDENTITY) continue;
     std::cout << "(K="   << static_cast<unsigned>(algo.key());
     std::cout << ", KA="; describe(algo.key_algo());
     std::cout << ", DA="; describe(algo.data_algo());
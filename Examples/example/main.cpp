@@ -49,12 +49,13 @@ void strings_obfuscation() {
   // Obfuscate a string literal and describe it after deobfuscation
   auto s1{"0123456789"_obf};
   describe(s1);
-  std::cout << s1 << "\n";
+  // Decode in-place (the conversion to const char*) and describe it after
+  std::cout << static_cast<const char*>(s1) << "\n";
   describe(s1);
 
   // Construct explicitly an ObfuscatedString
   auto s2 = ObfuscatedString("abcd", {1, KeyAlgorithm::IDENTITY, DataAlgorithm::XOR});
-  std::cout << s2 << '\n';
+  std::cout << static_cast<const char*>(s2) << '\n';
   describe(s2);
 
   // Construct explicitly an ObfuscatedString with precise obfuscation parameters
@@ -64,14 +65,16 @@ void strings_obfuscation() {
   };
   auto s3 = ObfuscatedString("abcde", params);
   describe(s3);
-  std::cout << s3 << '\n';
+  std::cout << static_cast<const char*>(s3) << '\n';
   describe(s3);
 
   static constexpr auto s4 = "An immutable compile-time string"_obf;
   describe(s4);
-  // It is not possible to use directly s4 since it is immutable:
-  // std::cout << s4 << '\n'; // Compilation failure
-  // So use decode() instead:
+  // It is not possible to decode s4 in-place since it is immutable:
+  // std::cout << static_cast<const char*>(s4) << '\n'; // Compilation failure
+  // But it can be streamed (decoded by small chunks):
+  std::cout << s4 << '\n';
+  // Or use decode() instead:
   std::cout << s4.decode() << '\n';
 }
 
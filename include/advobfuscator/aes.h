@@ -37,20 +37,70 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <type_traits>
+#include <utility>
 #include "random.h"
 #include "bytes.h"
+#include "obf.h"
 
 namespace andrivet::advobfuscator {
   /// Length of the cipher key
   static constexpr std::size_t n_key{128}; // 128-bit or 192-bit or 256-bit
 
-  // I prefer to use std::uin8_t instead of std::byte for the implicit conversions (from int)
-  using Byte = std::uint8_t;
   using Block = std::array<Byte, 128 / 8>;
   using Key = std::array<Byte, n_key / 8>;
   using Nonce = std::array<Byte, 8>;
 
+  /// Implementations of the AES cipher
+  enum class AesBackend {
+    REFERENCE, ///< Transformations of FIPS-197, one after the other
+    TTABLE,    ///< 32-bit lookup tables combining SubBytes, ShiftRows and MixColumns
+    AESNI,     ///< AES instructions of x86-64 processors for CTR mode when available, bitsliced otherwise
+    BITSLICED  ///< Constant-time, without tables: 4 blocks processed in parallel, bit by bit
+  };
+
+  /// Implementation of the AES cipher used by default
+  static constexpr AesBackend default_aes_backend{AesBackend::AESNI};
+
+  /// Standard number of rounds for a size of key.
+  /// \param key_bits Size of the key in bits (128, 192 or 256).
+  /// \return The number of rounds specified by FIPS-197.
+  consteval std::size_t standard_rounds(std::size_t key_bits) {
+    return key_bits == 128 ? 10 : key_bits == 192 ? 12 : 14;
+  }
+
+  /// Strength of AES: size of the key and number of rounds.
+  /// \tparam KeyBits Size of the key in bits (128, 192 or 256).
+  /// \tparam Rounds Number of rounds. Less rounds than the standard gives a faster, obfuscation grade, encryption.
+  template<std::size_t KeyBits = n_key, std::size_t Rounds = standard_rounds(KeyBits)>
+  struct AesPolicy {
+    static_assert(KeyBits == 128 || KeyBits == 192 || KeyBits == 256, "The size of an AES key is 128, 192 or 256 bits");
+    static_assert(Rounds >= 1 && Rounds <= standard_rounds(KeyBits), "Invalid number of AES rounds");
+
+    /// Size of the key in bits
+    static constexpr std::size_t key_bits = KeyBits;
+    /// Number of rounds
+    static constexpr std::size_t rounds = Rounds;
+    /// Key
+    using Key = std::array<Byte, KeyBits / 8>;
+    /// Expanded key (4 words for each round and for the initial AddRoundKey)
+    using EKey = std::array<std::array<Byte, 4>, 4 * (Rounds + 1)>;
+  };
+
+  /// Policy used by default (128-bit key, 10 rounds)
+  using DefaultAesPolicy = AesPolicy<>;
+  /// AES-128
+  using Aes128 = AesPolicy<128>;
+  /// AES-192
+  using Aes192 = AesPolicy<192>;
+  /// AES-256
+  using Aes256 = AesPolicy<256>;
+  /// Obfuscation grade: AES-128 with only 4 rounds, for latency-critical strings
+  using AesLight = AesPolicy<128, 4>;
+
   // ------------------------------------------------------------------
   // Internal details
   // ------------------------------------------------------------------
@@ -63,12 +113,18 @@ namespace andrivet::advobfuscator {
 
     /// Number of rounds
     consteval std::size_t n_rounds() {
-      static_assert(n_key == 128 || n_key == 192 || n_key == 256);
-      return n_key == 128 ? 10 : n_key == 192 ? 12 : 14;
+      return DefaultAesPolicy::rounds;
+    }
+
+    /// Number of rounds of an expanded key.
+    /// \tparam NW Number of words of the expanded key.
+    template<std::size_t NW>
+    consteval std::size_t n_rounds() {
+      return NW / 4 - 1;
     }
 
     // Expanded key
-    using EKey = std::array<Word, 4 * (n_rounds() + 1)>;
+    using EKey = DefaultAesPolicy::EKey;
 
     // Rijndael S-Box (obfuscated)
     static constexpr ObfuscatedBytes<16 * 3> sbox[16] = {
@@ -111,15 +167,30 @@ namespace andrivet::advobfuscator {
     // Rijndael round constants (obfuscated)
     static constexpr auto rcon = "01 02 04 08 10 20 40 80 1b 36"_obf_bytes;
 
-    /// Get high nibble
-    /// \param b Byte to which we want to extract the high nibble.
-    /// \return The high nibble
-    [[nodiscard]] constexpr Byte high(Byte b) { return b >> 4; }
+    /// S-Box decoded once from its obfuscated rows, for the length of a session (a call to encrypt, decrypt, ...).
+    /// \remark The decoded table is erased when the session ends.
+    class SBox {
+    public:
+      /// Decode the rows of an obfuscated S-Box.
+      /// \param rows The obfuscated rows (sbox or inv_sbox).
+      constexpr explicit SBox(const ObfuscatedBytes<16 * 3> (&rows)[16]) {
+        for(std::size_t r = 0; r < 16; ++r) rows[r].decode(0, 16, table_.data() + r * 16);
+      }
+      /// Destruct the session and erase the decoded table.
+      constexpr ~SBox() noexcept { erase(table_); }
+
+      // The decoded table is not copied
+      SBox(const SBox &) = delete;
+      SBox &operator=(const SBox &) = delete;
+
+      /// Substitute a byte.
+      /// \param b The byte to substitute.
+      /// \return The substituted byte.
+      [[nodiscard]] constexpr Byte operator[](Byte b) const noexcept { return table_[b]; }
 
-    /// Get low nibble
-    /// \param b Byte to which we want to extract the low nibble.
-    /// \return The low nibble
-    [[nodiscard]] constexpr Byte low(Byte b) { return b & 0x0F; }
+    private:
+      std::array<Byte, 256> table_{};
+    };
 
     /// Multiplication in GF(2^8) of two bytes.
     /// \param v0 First argument
@@ -144,50 +215,40 @@ namespace andrivet::advobfuscator {
       return product;
     }
 
+    /// Multiplication by x (i.e. {02}) in GF(2^8).
+    /// \param b The byte to multiply.
+    /// \return The result of the multiplication.
+    /// \remark Section 4.2.1
+    [[nodiscard]] constexpr Byte xtime(Byte b) {
+      return static_cast<Byte>(b << 1 ^ (b & 0x80 ? 0x1B : 0x00));
+    }
+
     /// SubWord Transformation - non-linear byte substitution using sbox.
     /// \param word Word to transform.
+    /// \param sbox Decoded S-Box.
     /// \return Transformed Word.
-    [[nodiscard]] constexpr Word sub_word(const Word &word) {
-      return Word{
-        sbox[high(word[0])][low(word[0])],
-        sbox[high(word[1])][low(word[1])],
-        sbox[high(word[2])][low(word[2])],
-        sbox[high(word[3])][low(word[3])]
-      };
+    [[nodiscard]] constexpr Word sub_word(const Word &word, const SBox &sbox) {
+      return Word{sbox[word[0]], sbox[word[1]], sbox[word[2]], sbox[word[3]]};
     }
 
     /// SubBytes Transformation - non-linear byte substitution using sbox.
     /// \param state State to transform.
+    /// \param sbox Decoded S-Box.
     /// \return Transformed state.
-    [[nodiscard]] constexpr State sub_bytes(const State &state) {
+    [[nodiscard]] constexpr State sub_bytes(const State &state, const SBox &sbox) {
       return State{
-        sub_word(state[0]),
-        sub_word(state[1]),
-        sub_word(state[2]),
-        sub_word(state[3])};
-    }
-
-    /// InvSubWord Transformation -Inverse of SubWord.
-    /// \param word Word to transform.
-    /// \return Transformed Word.
-    [[nodiscard]] constexpr Word inv_sub_word(const Word &word) {
-      return Word{
-        inv_sbox[high(word[0])][low(word[0])],
-        inv_sbox[high(word[1])][low(word[1])],
-        inv_sbox[high(word[2])][low(word[2])],
-        inv_sbox[high(word[3])][low(word[3])]
-      };
+        sub_word(state[0], sbox),
+        sub_word(state[1], sbox),
+        sub_word(state[2], sbox),
+        sub_word(state[3], sbox)};
     }
 
     /// InvSubBytes Transformation - Inverse of SubBytes.
     /// \param state State to transform.
+    /// \param inv_sbox Decoded inverse S-Box.
     /// \return Transformed state.
-    [[nodiscard]] constexpr State inv_sub_bytes(const State &state) {
-      return State{
-        inv_sub_word(state[0]),
-        inv_sub_word(state[1]),
-        inv_sub_word(state[2]),
-        inv_sub_word(state[3])};
+    [[nodiscard]] constexpr State inv_sub_bytes(const State &state, const SBox &inv_sbox) {
+      return sub_bytes(state, inv_sbox);
     }
 
     /// ShiftRows Transformation - bytes in the last three rows are cyclically shifted.
@@ -223,10 +284,12 @@ namespace andrivet::advobfuscator {
     [[nodiscard]] constexpr Word mix_column(const Word &c) {
       // 4.2.3 - The MixColumn transformation
       // c(x) = 3 * x^3 + 1 * x^2 + 1 * x + 2 modulo x^4 + 1
-      const auto v0{gmul(c[0], 0x02) ^ gmul(c[1], 0x03) ^      c[2]        ^ c[3]};
-      const auto v1{     c[0]        ^ gmul(c[1], 0x02) ^ gmul(c[2], 0x03) ^ c[3]};
-      const auto v2{     c[0]        ^      c[1]        ^ gmul(c[2], 0x02) ^ gmul(c[3], 0x03)};
-      const auto v3{gmul(c[0], 0x03) ^      c[1]        ^      c[2]        ^ gmul(c[3], 0x02)};
+      // 2 * a ^ 3 * b ^ c ^ d = a ^ b ^ c ^ d ^ 2 * (a ^ b)
+      const auto all{c[0] ^ c[1] ^ c[2] ^ c[3]};
+      const auto v0{c[0] ^ all ^ xtime(c[0] ^ c[1])};
+      const auto v1{c[1] ^ all ^ xtime(c[1] ^ c[2])};
+      const auto v2{c[2] ^ all ^ xtime(c[2] ^ c[3])};
+      const auto v3{c[3] ^ all ^ xtime(c[3] ^ c[0])};
       return Word{
         static_cast<Byte>(v0),
         static_cast<Byte>(v1),
@@ -239,17 +302,15 @@ namespace andrivet::advobfuscator {
     /// \return The transformed column.
     /// \remark Section 5.3.3
     [[nodiscard]] constexpr Word inv_mix_column(const Word &c) {
-      // 4.2.3 - The MixColumn transformation
-      // c(x) = 3 * x^3 + 1 * x^2 + 1 * x + 2 modulo x^4 + 1
-      const auto v0{gmul(c[0], 0x0e) ^ gmul(c[1], 0x0b) ^ gmul(c[2], 0x0d) ^ gmul(c[3], 0x09)};
-      const auto v1{gmul(c[0], 0x09) ^ gmul(c[1], 0x0e) ^ gmul(c[2], 0x0b) ^ gmul(c[3], 0x0d)};
-      const auto v2{gmul(c[0], 0x0d) ^ gmul(c[1], 0x09) ^ gmul(c[2], 0x0e) ^ gmul(c[3], 0x0b)};
-      const auto v3{gmul(c[0], 0x0b) ^ gmul(c[1], 0x0d) ^ gmul(c[2], 0x09) ^ gmul(c[3], 0x0e)};
-      return Word{
-        static_cast<Byte>(v0),
-        static_cast<Byte>(v1),
-        static_cast<Byte>(v2),
-        static_cast<Byte>(v3)};
+      // d(x) = 0B * x^3 + 0D * x^2 + 09 * x + 0E = c(x) * (04 * x^2 + 05) modulo x^4 + 1
+      // so InvMixColumns is MixColumns after adding 4 * (c[0] ^ c[2]) and 4 * (c[1] ^ c[3])
+      const auto u{xtime(xtime(c[0] ^ c[2]))};
+      const auto v{xtime(xtime(c[1] ^ c[3]))};
+      return mix_column(Word{
+        static_cast<Byte>(c[0] ^ u),
+        static_cast<Byte>(c[1] ^ v),
+        static_cast<Byte>(c[2] ^ u),
+        static_cast<Byte>(c[3] ^ v)});
     }
 
     /// MixColumns Transformation - Multiply columns by a fixed polynomial.
@@ -271,7 +332,8 @@ namespace andrivet::advobfuscator {
     /// \param ekey The round key.
     /// \return The transformed state.
     /// \remark Section 5.1.4
-    [[nodiscard]] constexpr State add_round_key(const State &state, const EKey &ekey, std::size_t round) {
+    template<std::size_t NW>
+    [[nodiscard]] constexpr State add_round_key(const State &state, const std::array<Word, NW> &ekey, std::size_t round) {
       State new_state;
       for(std::size_t c = 0; c < 4; ++c)
         for(std::size_t r = 0; r < 4; ++r)
@@ -313,32 +375,44 @@ namespace andrivet::advobfuscator {
     }
 
     /// Key Expansion - Generate a key schedule.
+    /// \tparam Policy Size of the key and number of rounds.
     /// \param key The key to be expanded.
+    /// \param substitute SubWord Transformation (using a decoded S-Box or constant-time).
     /// \return The expanded key.
-    /// \remark Section 5.2
-    [[nodiscard]] constexpr EKey key_expansion(const Key &key) {
-      EKey ekey;
-      const auto nk = n_key / 32;
+    /// \remark Section 5.2. With less rounds than the standard, the key schedule is truncated.
+    template<typename Policy = DefaultAesPolicy, typename SubWord>
+    [[nodiscard]] constexpr typename Policy::EKey key_expansion(const typename Policy::Key &key, SubWord &&substitute) {
+      typename Policy::EKey ekey;
+      const auto nk = Policy::key_bits / 32;
 
       // First 4 words: copy of the encryption key
       for(std::size_t i = 0; i < nk; ++i)
         ekey[i] = {key[4 * i], key[4 * i + 1], key[4 * i + 2], key[4 * i + 3]};
 
-      const auto n_r = n_rounds();
-      for(std::size_t i = nk; i < 4 * (n_r + 1); ++i) {
+      for(std::size_t i = nk; i < ekey.size(); ++i) {
         Word temp = ekey[i - 1];
         if(i % nk == 0) {
-          temp = sub_word(rot_word(temp));
+          temp = substitute(rot_word(temp));
           temp[0] ^= rcon[i / nk - 1];
         }
         else if(nk > 6 and i % nk == 4)
-          temp = sub_word(temp);
-        ekey[i] = ekey[i - 4] ^ temp;
+          temp = substitute(temp);
+        ekey[i] = ekey[i - nk] ^ temp;
       }
 
       return ekey;
     }
 
+    /// Key Expansion - Generate a key schedule.
+    /// \tparam Policy Size of the key and number of rounds.
+    /// \param key The key to be expanded.
+    /// \return The expanded key.
+    template<typename Policy = DefaultAesPolicy>
+    [[nodiscard]] constexpr typename Policy::EKey key_expansion(const typename Policy::Key &key) {
+      const SBox s{sbox};
+      return key_expansion<Policy>(key, [&](const Word &w) { return sub_word(w, s); });
+    }
+
     /// Create a State from a Block.
     /// \param block The Block used to create the State.
     /// \return The State created from the Block.
@@ -357,25 +431,1156 @@ namespace andrivet::advobfuscator {
       return block;
     }
 
+    /// Create the counter block used to encrypt a block of data (CTR mode).
+    /// \param nonce The nonce of the stream.
+    /// \param index The index of the block of data in the stream.
+    /// \return The nonce followed by the counter (little-endian).
+    /// \remark The counter is updated after a block is encrypted, with the index of this block.
+    /// So the first two blocks use a counter of 0, and then block i uses the counter i - 1.
+    [[nodiscard]] constexpr Block counter_block(const Nonce &nonce, std::size_t index) {
+      const std::uint64_t counter = index == 0 ? 0 : index - 1;
+      Block ctr{
+        nonce[0], nonce[1], nonce[2], nonce[3], nonce[4], nonce[5], nonce[6], nonce[7],
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+      };
+      for(std::size_t j = 0; j < 8; ++j) ctr[8 + j] = static_cast<Byte>((counter >> j * 8) & 0x00000000000000FF);
+      return ctr;
+    }
+
+    /// Cipher - Encrypt a block.
+    /// \param block Block to be encrypted.
+    /// \param ekey Expanded key.
+    /// \param sbox Decoded S-Box.
+    /// \return The encrypted block.
+    /// \remark Section 5.1
+    template<std::size_t NW>
+    [[nodiscard]] constexpr Block cipher(const Block &block, const std::array<Word, NW> &ekey, const SBox &sbox) {
+      constexpr auto n_r = n_rounds<NW>();
+      State state = add_round_key(to_state(block), ekey, 0);
+      for(std::size_t round = 1; round < n_r; ++round)
+        state = add_round_key(mix_columns(shift_rows(sub_bytes(state, sbox))), ekey, round);
+      state = add_round_key(shift_rows(sub_bytes(state, sbox)), ekey, n_r);
+      return to_block(state);
+    }
+
+    /// InvCipher - Decrypt a block.
+    /// \param block Block to be decrypted.
+    /// \param ekey Expanded key.
+    /// \param inv_sbox Decoded inverse S-Box.
+    /// \return The decrypted block.
+    /// \remark Section 5.3
+    template<std::size_t NW>
+    [[nodiscard]] constexpr Block inv_cipher(const Block &block, const std::array<Word, NW> &ekey, const SBox &inv_sbox) {
+      constexpr auto n_r = n_rounds<NW>();
+      State state = add_round_key(to_state(block), ekey, n_r);
+      for(std::size_t round = n_r - 1; round >= 1; --round)
+        state = inv_mix_columns(add_round_key(inv_sub_bytes(inv_shift_rows(state), inv_sbox), ekey, round));
+      state = add_round_key(inv_sub_bytes(inv_shift_rows(state), inv_sbox), ekey, 0);
+      return to_block(state);
+    }
+  }
+
+  // ------------------------------------------------------------------
+  // T-tables
+  // ------------------------------------------------------------------
+
+  namespace details {
+    /// Compute the T-table of the encryption: for each byte x, the column (2.S[x], S[x], S[x], 3.S[x]).
+    /// \return The T-table, as an array of little-endian words.
+    /// \remark The tables of the other rows are rotations of this one.
+    consteval std::array<Byte, 256 * 4> make_te0() {
+      const SBox s{sbox};
+      std::array<Byte, 256 * 4> table{};
+      for(std::size_t x = 0; x < 256; ++x) {
+        const Byte b = s[static_cast<Byte>(x)];
+        table[x * 4 + 0] = xtime(b);
+        table[x * 4 + 1] = b;
+        table[x * 4 + 2] = b;
+        table[x * 4 + 3] = xtime(b) ^ b;
+      }
+      return table;
+    }
+
+    /// Compute the T-table of the decryption: for each byte x, the column (14.Si[x], 9.Si[x], 13.Si[x], 11.Si[x]).
+    /// \return The T-table, as an array of little-endian words.
+    /// \remark The tables of the other rows are rotations of this one.
+    consteval std::array<Byte, 256 * 4> make_td0() {
+      const SBox s{inv_sbox};
+      std::array<Byte, 256 * 4> table{};
+      for(std::size_t x = 0; x < 256; ++x) {
+        const Byte b = s[static_cast<Byte>(x)];
+        table[x * 4 + 0] = gmul(b, 0x0e);
+        table[x * 4 + 1] = gmul(b, 0x09);
+        table[x * 4 + 2] = gmul(b, 0x0d);
+        table[x * 4 + 3] = gmul(b, 0x0b);
+      }
+      return table;
+    }
+
+    // T-tables (generated and obfuscated at compile-time)
+    static constexpr ObfuscatedBytes<256 * 4 * 3> te0{make_te0()};
+    static constexpr ObfuscatedBytes<256 * 4 * 3> td0{make_td0()};
+
+    /// Pack 4 bytes into a word (little-endian).
+    [[nodiscard]] constexpr std::uint32_t pack(Byte b0, Byte b1, Byte b2, Byte b3) {
+      return std::uint32_t{b0} | std::uint32_t{b1} << 8 | std::uint32_t{b2} << 16 | std::uint32_t{b3} << 24;
+    }
+
+    /// Pack a Word (4 bytes) into a word (little-endian).
+    [[nodiscard]] constexpr std::uint32_t pack(const Word &w) { return pack(w[0], w[1], w[2], w[3]); }
+
+    /// Extract a byte (a row) of a word (little-endian).
+    [[nodiscard]] constexpr Byte row(std::uint32_t w, std::size_t r) { return static_cast<Byte>(w >> (r * 8)); }
+
+    /// T-table decoded once from its obfuscated version, for the length of a session (a call to encrypt, decrypt, ...).
+    /// \remark The decoded table is erased when the session ends.
+    class TTable {
+    public:
+      /// Decode an obfuscated T-table.
+      /// \param obfuscated The obfuscated table (te0 or td0).
+      constexpr explicit TTable(const ObfuscatedBytes<256 * 4 * 3> &obfuscated) {
+        std::array<Byte, 256 * 4> bytes{};
+        obfuscated.decode(0, bytes.size(), bytes.data());
+        for(std::size_t x = 0; x < 256; ++x)
+          table_[x] = pack(bytes[x * 4], bytes[x * 4 + 1], bytes[x * 4 + 2], bytes[x * 4 + 3]);
+        erase(bytes);
+      }
+      /// Destruct the session and erase the decoded table.
+      constexpr ~TTable() noexcept { erase(table_); }
+
+      // The decoded table is not copied
+      TTable(const TTable &) = delete;
+      TTable &operator=(const TTable &) = delete;
+
+      /// Get the column of a byte for a row.
+      /// \param b The byte.
+      /// \param r The row of the byte in its column (0 to 3).
+      /// \return The column, for this byte and this row.
+      [[nodiscard]] constexpr std::uint32_t operator()(Byte b, std::size_t r) const noexcept {
+        return std::rotl(table_[b], static_cast<int>(r * 8));
+      }
+
+    private:
+      std::array<std::uint32_t, 256> table_{};
+    };
+
+    /// Cipher using T-tables.
+    /// \param block Block to be encrypted.
+    /// \param ekey Expanded key.
+    /// \param te Decoded T-table of the encryption.
+    /// \param sbox Decoded S-Box (for the last round).
+    /// \return The encrypted block.
+    template<std::size_t NW>
+    [[nodiscard]] constexpr Block ttable_cipher(const Block &block, const std::array<Word, NW> &ekey, const TTable &te,
+                                                const SBox &sbox) {
+      constexpr auto n_r = n_rounds<NW>();
+      std::array<std::uint32_t, 4> s;
+      for(std::size_t c = 0; c < 4; ++c)
+        s[c] = pack(block[c * 4], block[c * 4 + 1], block[c * 4 + 2], block[c * 4 + 3]) ^ pack(ekey[c]);
+
+      // SubBytes, ShiftRows (row r of column c comes from column c + r), MixColumns and AddRoundKey
+      for(std::size_t round = 1; round < n_r; ++round) {
+        std::array<std::uint32_t, 4> t;
+        for(std::size_t c = 0; c < 4; ++c)
+          t[c] = te(row(s[c], 0), 0) ^ te(row(s[(c + 1) % 4], 1), 1) ^
+                 te(row(s[(c + 2) % 4], 2), 2) ^ te(row(s[(c + 3) % 4], 3), 3) ^ pack(ekey[round * 4 + c]);
+        s = t;
+      }
+
+      // Last round: no MixColumns
+      Block encrypted;
+      for(std::size_t c = 0; c < 4; ++c)
+        for(std::size_t r = 0; r < 4; ++r)
+          encrypted[c * 4 + r] = sbox[row(s[(c + r) % 4], r)] ^ ekey[n_r * 4 + c][r];
+      return encrypted;
+    }
+
+    /// InvMixColumns Transformation of a round key using T-tables.
+    /// \param w The word of the round key.
+    /// \param td Decoded T-table of the decryption.
+    /// \param sbox Decoded S-Box (to cancel the inverse S-Box included in the T-table).
+    /// \return The transformed word.
+    [[nodiscard]] constexpr std::uint32_t ttable_inv_mix_column(const Word &w, const TTable &td, const SBox &sbox) {
+      return td(sbox[w[0]], 0) ^ td(sbox[w[1]], 1) ^ td(sbox[w[2]], 2) ^ td(sbox[w[3]], 3);
+    }
+
+    /// Round keys of the equivalent inverse cipher, as little-endian words.
+    template<std::size_t NW>
+    using InvRoundKeys = std::array<std::uint32_t, NW>;
+
+    /// Compute the round keys of the equivalent inverse cipher: InvMixColumns is applied to the rounds 1 to Nr - 1.
+    /// \param ekey Expanded key.
+    /// \param td Decoded T-table of the decryption.
+    /// \param sbox Decoded S-Box (to cancel the inverse S-Box included in the T-table).
+    /// \return The round keys.
+    /// \remark Section 5.3.5
+    template<std::size_t NW>
+    [[nodiscard]] constexpr InvRoundKeys<NW> ttable_inv_round_keys(const std::array<Word, NW> &ekey, const TTable &td,
+                                                                   const SBox &sbox) {
+      constexpr auto n_r = n_rounds<NW>();
+      InvRoundKeys<NW> dk;
+      for(std::size_t i = 0; i < NW; ++i)
+        dk[i] = i < 4 || i >= n_r * 4 ? pack(ekey[i]) : ttable_inv_mix_column(ekey[i], td, sbox);
+      return dk;
+    }
+
+    /// Equivalent inverse cipher using T-tables.
+    /// \param block Block to be decrypted.
+    /// \param dk Round keys of the equivalent inverse cipher.
+    /// \param td Decoded T-table of the decryption.
+    /// \param inv_sbox Decoded inverse S-Box (for the last round).
+    /// \return The decrypted block.
+    /// \remark Section 5.3.5
+    template<std::size_t NW>
+    [[nodiscard]] constexpr Block ttable_inv_cipher(const Block &block, const InvRoundKeys<NW> &dk, const TTable &td,
+                                                    const SBox &inv_sbox) {
+      constexpr auto n_r = n_rounds<NW>();
+      std::array<std::uint32_t, 4> s;
+      for(std::size_t c = 0; c < 4; ++c)
+        s[c] = pack(block[c * 4], block[c * 4 + 1], block[c * 4 + 2], block[c * 4 + 3]) ^ dk[n_r * 4 + c];
+
+      // InvShiftRows (row r of column c comes from column c - r), InvSubBytes, InvMixColumns and AddRoundKey
+      for(std::size_t round = n_r - 1; round >= 1; --round) {
+        std::array<std::uint32_t, 4> t;
+        for(std::size_t c = 0; c < 4; ++c)
+          t[c] = td(row(s[c], 0), 0) ^ td(row(s[(c + 3) % 4], 1), 1) ^
+                 td(row(s[(c + 2) % 4], 2), 2) ^ td(row(s[(c + 1) % 4], 3), 3) ^ dk[round * 4 + c];
+        s = t;
+      }
+
+      // Last round: no InvMixColumns
+      Block decrypted;
+      for(std::size_t c = 0; c < 4; ++c)
+        for(std::size_t r = 0; r < 4; ++r)
+          decrypted[c * 4 + r] = inv_sbox[row(s[(c + 4 - r) % 4], r)] ^ row(dk[c], r);
+      return decrypted;
+    }
+
+    /// Tables used to encrypt blocks with a backend, decoded for the length of a session.
+    template<AesBackend backend>
+    class EncryptionSession;
+
+    /// Tables used to decrypt blocks with a backend, decoded for the length of a session.
+    template<AesBackend backend>
+    class DecryptionSession;
+
+    template<>
+    class EncryptionSession<AesBackend::REFERENCE> {
+    public:
+      template<std::size_t NW>
+      [[nodiscard]] constexpr Block operator()(const Block &block, const std::array<Word, NW> &ekey) const {
+        return cipher(block, ekey, sbox_);
+      }
+
+    private:
+      SBox sbox_{sbox};
+    };
+
+    template<>
+    class DecryptionSession<AesBackend::REFERENCE> {
+    public:
+      template<std::size_t NW>
+      [[nodiscard]] constexpr Block operator()(const Block &block, const std::array<Word, NW> &ekey) const {
+        return inv_cipher(block, ekey, inv_sbox_);
+      }
+
+    private:
+      SBox inv_sbox_{inv_sbox};
+    };
+
+    template<>
+    class EncryptionSession<AesBackend::TTABLE> {
+    public:
+      template<std::size_t NW>
+      [[nodiscard]] constexpr Block operator()(const Block &block, const std::array<Word, NW> &ekey) const {
+        return ttable_cipher(block, ekey, te_, sbox_);
+      }
+
+    private:
+      TTable te_{te0};
+      SBox sbox_{sbox};
+    };
+
+    template<>
+    class DecryptionSession<AesBackend::TTABLE> {
+    public:
+      template<std::size_t NW>
+      [[nodiscard]] constexpr Block operator()(const Block &block, const std::array<Word, NW> &ekey) const {
+        auto dk = ttable_inv_round_keys(ekey, td_, sbox_);
+        const auto decrypted = ttable_inv_cipher(block, dk, td_, inv_sbox_);
+        erase(dk);
+        return decrypted;
+      }
+
+      /// Decrypt blocks in-place, with the round keys of the equivalent inverse cipher computed once.
+      /// \param data The blocks to decrypt.
+      /// \param nb_blocks Number of blocks.
+      /// \param ekey Expanded key.
+      template<std::size_t NW>
+      void operator()(Byte *data, std::size_t nb_blocks, const std::array<Word, NW> &ekey) const {
+        auto dk = ttable_inv_round_keys(ekey, td_, sbox_);
+        Block block;
+        for(std::size_t i = 0; i < nb_blocks; ++i, data += 16) {
+          std::copy_n(data, 16, block.begin());
+          block = ttable_inv_cipher(block, dk, td_, inv_sbox_);
+          std::copy_n(block.begin(), 16, data);
+        }
+        erase(block);
+        erase(dk);
+      }
+
+    private:
+      TTable td_{td0};
+      SBox inv_sbox_{inv_sbox};
+      SBox sbox_{sbox};
+    };
+  }
+
+  // ------------------------------------------------------------------
+  // AES-NI
+  // ------------------------------------------------------------------
+
+  namespace details {
+    // Single blocks and constant evaluation: same as T-tables (only decrypt_ctr uses the AES instructions)
+    template<>
+    class EncryptionSession<AesBackend::AESNI>: public EncryptionSession<AesBackend::TTABLE> {};
+
+    template<>
+    class DecryptionSession<AesBackend::AESNI>: public DecryptionSession<AesBackend::TTABLE> {};
+  }
+
+#if defined(ADVOBFUSCATOR_X86_64)
+  namespace details::aesni {
+    /// Number of counter blocks encrypted at once (to hide the latency of AESENC)
+    static const std::size_t PIPELINE = 8;
+
+    /// Round keys loaded into vector registers.
+    template<std::size_t NW>
+    using RoundKeys = __m128i[NW / 4];
+
+    /// Encrypt a block with AES instructions.
+    /// \param block The block to encrypt.
+    /// \param keys The round keys.
+    /// \return The encrypted block.
+    template<std::size_t NW>
+    ADVOBFUSCATOR_TARGET("aes,sse2")
+    inline __m128i encrypt(__m128i block, const RoundKeys<NW> &keys) {
+      constexpr auto n_r = n_rounds<NW>();
+      block = _mm_xor_si128(block, keys[0]);
+      for(std::size_t round = 1; round < n_r; ++round) block = _mm_aesenc_si128(block, keys[round]);
+      return _mm_aesenclast_si128(block, keys[n_r]);
+    }
+
+    /// Combine a part of a block of data with a key stream.
+    /// \param data The data to combine.
+    /// \param size The number of bytes to combine (at most 16).
+    /// \param skip The position of the first byte in the block of key stream.
+    /// \param stream The block of key stream.
+    ADVOBFUSCATOR_TARGET("aes,sse2")
+    inline void combine(Byte *data, std::size_t size, std::size_t skip, __m128i stream) {
+      Block bytes;
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(bytes.data()), stream);
+      for(std::size_t j = 0; j < size; ++j) data[j] ^= bytes[skip + j];
+      erase(bytes);
+    }
+
+    /// Decrypt in-place with AES instructions using CTR (Counter) mode.
+    /// \param data bytes to be decrypted with AES.
+    /// \param ekey Expanded key.
+    /// \param nonce The random nonce of the stream.
+    /// \param offset Position of the first byte in the stream.
+    /// \remark The counters are kept in a vector register and the counter blocks are encrypted by groups.
+    template<std::size_t NW>
+    ADVOBFUSCATOR_TARGET("aes,sse2")
+    inline void decrypt_ctr(Byte *data, std::size_t size, const std::array<Word, NW> &ekey, const Nonce &nonce,
+                            std::size_t offset) {
+      constexpr auto n_r = n_rounds<NW>();
+      RoundKeys<NW> keys;
+      for(std::size_t round = 0; round <= n_r; ++round)
+        keys[round] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ekey[round * 4].data()));
+
+      auto block = offset / 16;
+      auto skip = offset % 16;
+      // A partial first block, or the block 0 that shares its counter with the block 1
+      while(size > 0 && (skip != 0 || block == 0)) {
+        const auto ctr = counter_block(nonce, block++);
+        const auto nb_bytes = std::min(16 - skip, size);
+        combine(data, nb_bytes, skip, encrypt<NW>(_mm_loadu_si128(reinterpret_cast<const __m128i *>(ctr.data())), keys));
+        data += nb_bytes;
+        size -= nb_bytes;
+        skip = 0;
+      }
+
+      // From now, the counter is incremented for each block.
+      // It is a 64-bit little-endian number in the upper half of the counter block.
+      const auto ctr_block = counter_block(nonce, block);
+      auto ctr = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ctr_block.data()));
+      const auto one = _mm_set_epi64x(1, 0);
+
+      __m128i stream[PIPELINE];
+      while(size >= PIPELINE * 16) {
+        for(std::size_t i = 0; i < PIPELINE; ++i) {
+          stream[i] = _mm_xor_si128(ctr, keys[0]);
+          ctr = _mm_add_epi64(ctr, one);
+        }
+        for(std::size_t round = 1; round < n_r; ++round)
+          for(std::size_t i = 0; i < PIPELINE; ++i) stream[i] = _mm_aesenc_si128(stream[i], keys[round]);
+        for(std::size_t i = 0; i < PIPELINE; ++i) {
+          stream[i] = _mm_aesenclast_si128(stream[i], keys[n_r]);
+          auto *p = reinterpret_cast<__m128i *>(data + i * 16);
+          _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), stream[i]));
+        }
+        data += PIPELINE * 16;
+        size -= PIPELINE * 16;
+      }
+
+      while(size >= 16) {
+        auto *p = reinterpret_cast<__m128i *>(data);
+        _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), encrypt<NW>(ctr, keys)));
+        ctr = _mm_add_epi64(ctr, one);
+        data += 16;
+        size -= 16;
+      }
+
+      if(size > 0) combine(data, size, 0, encrypt<NW>(ctr, keys));
+      erase(stream);
+      erase(keys);
+    }
+
+    /// Encrypt blocks in-place with AES instructions, each one with its own key (multi-buffer).
+    /// \param blocks The blocks to encrypt.
+    /// \param ekeys The expanded key of each block.
+    /// \param count Number of blocks.
+    /// \remark The blocks are encrypted by groups, to keep the pipeline full even with several keys.
+    template<std::size_t NW>
+    ADVOBFUSCATOR_TARGET("aes,sse2")
+    inline void encrypt_blocks(Block *blocks, const std::array<Word, NW> *const *ekeys, std::size_t count) {
+      constexpr auto n_r = n_rounds<NW>();
+      const auto key = [ekeys](std::size_t i, std::size_t round) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>((*ekeys[i])[round * 4].data()));
+      };
+
+      __m128i state[PIPELINE];
+      for(std::size_t first = 0; first < count; first += PIPELINE) {
+        const auto n = std::min(PIPELINE, count - first);
+        for(std::size_t i = 0; i < n; ++i)
+          state[i] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(blocks[first + i].data())),
+                                   key(first + i, 0));
+        for(std::size_t round = 1; round < n_r; ++round)
+          for(std::size_t i = 0; i < n; ++i) state[i] = _mm_aesenc_si128(state[i], key(first + i, round));
+        for(std::size_t i = 0; i < n; ++i)
+          _mm_storeu_si128(reinterpret_cast<__m128i *>(blocks[first + i].data()),
+                           _mm_aesenclast_si128(state[i], key(first + i, n_r)));
+      }
+      erase(state);
+    }
+
+    /// Decrypt blocks in-place with AES instructions (equivalent inverse cipher).
+    /// \param data The blocks to decrypt.
+    /// \param nb_blocks Number of blocks.
+    /// \param ekey Expanded key.
+    /// \remark The round keys are transformed by InvMixColumns once, and the blocks are decrypted by groups.
+    template<std::size_t NW>
+    ADVOBFUSCATOR_TARGET("aes,sse2")
+    inline void decrypt_blocks(Byte *data, std::size_t nb_blocks, const std::array<Word, NW> &ekey) {
+      constexpr auto n_r = n_rounds<NW>();
+      const auto key = [&ekey](std::size_t round) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(ekey[round * 4].data()));
+      };
+      RoundKeys<NW> keys;
+      keys[0] = key(n_r);
+      for(std::size_t round = 1; round < n_r; ++round) keys[round] = _mm_aesimc_si128(key(n_r - round));
+      keys[n_r] = key(0);
+
+      __m128i state[PIPELINE];
+      for(std::size_t first = 0; first < nb_blocks; first += PIPELINE) {
+        const auto n = std::min(PIPELINE, nb_blocks - first);
+        auto *p = reinterpret_cast<__m128i *>(data + first * 16);
+        for(std::size_t i = 0; i < n; ++i) state[i] = _mm_xor_si128(_mm_loadu_si128(p + i), keys[0]);
+        for(std::size_t round = 1; round < n_r; ++round)
+          for(std::size_t i = 0; i < n; ++i) state[i] = _mm_aesdec_si128(state[i], keys[round]);
+        for(std::size_t i = 0; i < n; ++i) _mm_storeu_si128(p + i, _mm_aesdeclast_si128(state[i], keys[n_r]));
+      }
+      erase(state);
+      erase(keys);
+    }
+  }
+#endif
+
+  // ------------------------------------------------------------------
+  // Bitsliced
+  // ------------------------------------------------------------------
+
+  /// Constant-time implementation: 4 blocks are processed in parallel, bit by bit, without any table.
+  /// Each 64-bit word (plane) holds one bit of each of the 64 bytes. In a plane, the bit of the byte at
+  /// row r and column c of block b is at position (r * 4 + c) * 4 + b, so each row occupies 16 bits.
+  namespace details::bitsliced {
+    /// Bit planes: plane i holds the bit i of each byte.
+    using Planes = std::array<std::uint64_t, 8>;
+    /// Round keys as bit planes.
+    template<std::size_t NW>
+    using RoundKeys = std::array<Planes, NW / 4>;
+    /// Number of blocks processed in parallel
+    static const std::size_t NB_BLOCKS = 4;
+
+    /// Exchange bits between two words.
+    constexpr void swap_move(std::uint64_t &a, std::uint64_t &b, std::uint64_t mask, int n) {
+      const std::uint64_t t = ((a >> n) ^ b) & mask;
+      b ^= t;
+      a ^= t << n;
+    }
+
+    /// Transpose 8 words, seen as 8 matrices of 8x8 bits (one for each byte of the words).
+    /// \remark The transposition is its own inverse.
+    constexpr void transpose(Planes &q) {
+      swap_move(q[0], q[1], 0x5555555555555555, 1);
+      swap_move(q[2], q[3], 0x5555555555555555, 1);
+      swap_move(q[4], q[5], 0x5555555555555555, 1);
+      swap_move(q[6], q[7], 0x5555555555555555, 1);
+      swap_move(q[0], q[2], 0x3333333333333333, 2);
+      swap_move(q[1], q[3], 0x3333333333333333, 2);
+      swap_move(q[4], q[6], 0x3333333333333333, 2);
+      swap_move(q[5], q[7], 0x3333333333333333, 2);
+      swap_move(q[0], q[4], 0x0F0F0F0F0F0F0F0F, 4);
+      swap_move(q[1], q[5], 0x0F0F0F0F0F0F0F0F, 4);
+      swap_move(q[2], q[6], 0x0F0F0F0F0F0F0F0F, 4);
+      swap_move(q[3], q[7], 0x0F0F0F0F0F0F0F0F, 4);
+    }
+
+    /// Spread the 4 bytes of a 32-bit word into the even bytes of a 64-bit word.
+    constexpr std::uint64_t spread(std::uint64_t x) {
+      x = (x | x << 16) & 0x0000FFFF0000FFFF;
+      return (x | x << 8) & 0x00FF00FF00FF00FF;
+    }
+
+    /// Gather the even bytes of a 64-bit word into a 32-bit word (inverse of spread).
+    constexpr std::uint32_t gather(std::uint64_t x) {
+      x &= 0x00FF00FF00FF00FF;
+      x = (x | x >> 8) & 0x0000FFFF0000FFFF;
+      return static_cast<std::uint32_t>(x | x >> 16);
+    }
+
+    /// Load 4 bytes of a block (little-endian).
+    constexpr std::uint32_t load(const Block &block, std::size_t pos) {
+      return details::pack(block[pos], block[pos + 1], block[pos + 2], block[pos + 3]);
+    }
+
+    /// Store 4 bytes into a block (little-endian).
+    constexpr void store(Block &block, std::size_t pos, std::uint32_t w) {
+      for(std::size_t i = 0; i < 4; ++i) block[pos + i] = static_cast<Byte>(w >> (8 * i));
+    }
+
+    /// Convert blocks into bit planes.
+    /// \param blocks The blocks to convert.
+    /// \return The bit planes.
+    /// \remark After the transposition, the byte j of the word k becomes the bit 8 * j + k of each plane.
+    /// So the word k holds bytes of the block k % 4: columns 0 and 2 (k < 4) or 1 and 3 (k >= 4), interleaved.
+    constexpr Planes pack(const std::array<Block, NB_BLOCKS> &blocks) {
+      Planes q;
+      for(std::size_t k = 0; k < 8; ++k) {
+        const auto &block = blocks[k % 4];
+        const auto c = k / 4;
+        q[k] = spread(load(block, c * 4)) | spread(load(block, (c + 2) * 4)) << 8;
+      }
+      transpose(q);
+      return q;
+    }
+
+    /// Convert bit planes into blocks.
+    /// \param q The bit planes.
+    /// \return The blocks.
+    constexpr std::array<Block, NB_BLOCKS> unpack(Planes q) {
+      transpose(q);
+      std::array<Block, NB_BLOCKS> blocks;
+      for(std::size_t k = 0; k < 8; ++k) {
+        auto &block = blocks[k % 4];
+        const auto c = k / 4;
+        store(block, c * 4, gather(q[k]));
+        store(block, (c + 2) * 4, gather(q[k] >> 8));
+      }
+      return blocks;
+    }
+
+    /// SubBytes Transformation - S-Box computed by a boolean circuit.
+    /// \param q The bit planes to transform.
+    /// \remark Circuit of Joan Boyar and René Peralta (113 gates), "A depth-16 circuit for the AES S-box".
+    constexpr void sub_bytes(Planes &q) {
+      const auto x0 = q[7], x1 = q[6], x2 = q[5], x3 = q[4], x4 = q[3], x5 = q[2], x6 = q[1], x7 = q[0];
+
+      // Top linear transformation
+      const auto y14 = x3 ^ x5;
+      const auto y13 = x0 ^ x6;
+      const auto y9 = x0 ^ x3;
+      const auto y8 = x0 ^ x5;
+      const auto t0 = x1 ^ x2;
+      const auto y1 = t0 ^ x7;
+      const auto y4 = y1 ^ x3;
+      const auto y12 = y13 ^ y14;
+      const auto y2 = y1 ^ x0;
+      const auto y5 = y1 ^ x6;
+      const auto y3 = y5 ^ y8;
+      const auto t1 = x4 ^ y12;
+      const auto y15 = t1 ^ x5;
+      const auto y20 = t1 ^ x1;
+      const auto y6 = y15 ^ x7;
+      const auto y10 = y15 ^ t0;
+      const auto y11 = y20 ^ y9;
+      const auto y7 = x7 ^ y11;
+      const auto y17 = y10 ^ y11;
+      const auto y19 = y10 ^ y8;
+      const auto y16 = t0 ^ y11;
+      const auto y21 = y13 ^ y16;
+      const auto y18 = x0 ^ y16;
+
+      // Non-linear section
+      const auto t2 = y12 & y15;
+      const auto t3 = y3 & y6;
+      const auto t4 = t3 ^ t2;
+      const auto t5 = y4 & x7;
+      const auto t6 = t5 ^ t2;
+      const auto t7 = y13 & y16;
+      const auto t8 = y5 & y1;
+      const auto t9 = t8 ^ t7;
+      const auto t10 = y2 & y7;
+      const auto t11 = t10 ^ t7;
+      const auto t12 = y9 & y11;
+      const auto t13 = y14 & y17;
+      const auto t14 = t13 ^ t12;
+      const auto t15 = y8 & y10;
+      const auto t16 = t15 ^ t12;
+      const auto t17 = t4 ^ t14;
+      const auto t18 = t6 ^ t16;
+      const auto t19 = t9 ^ t14;
+      const auto t20 = t11 ^ t16;
+      const auto t21 = t17 ^ y20;
+      const auto t22 = t18 ^ y19;
+      const auto t23 = t19 ^ y21;
+      const auto t24 = t20 ^ y18;
+
+      const auto t25 = t21 ^ t22;
+      const auto t26 = t21 & t23;
+      const auto t27 = t24 ^ t26;
+      const auto t28 = t25 & t27;
+      const auto t29 = t28 ^ t22;
+      const auto t30 = t23 ^ t24;
+      const auto t31 = t22 ^ t26;
+      const auto t32 = t31 & t30;
+      const auto t33 = t32 ^ t24;
+      const auto t34 = t23 ^ t33;
+      const auto t35 = t27 ^ t33;
+      const auto t36 = t24 & t35;
+      const auto t37 = t36 ^ t34;
+      const auto t38 = t27 ^ t36;
+      const auto t39 = t29 & t38;
+      const auto t40 = t25 ^ t39;
+
+      const auto t41 = t40 ^ t37;
+      const auto t42 = t29 ^ t33;
+      const auto t43 = t29 ^ t40;
+      const auto t44 = t33 ^ t37;
+      const auto t45 = t42 ^ t41;
+      const auto z0 = t44 & y15;
+      const auto z1 = t37 & y6;
+      const auto z2 = t33 & x7;
+      const auto z3 = t43 & y16;
+      const auto z4 = t40 & y1;
+      const auto z5 = t29 & y7;
+      const auto z6 = t42 & y11;
+      const auto z7 = t45 & y17;
+      const auto z8 = t41 & y10;
+      const auto z9 = t44 & y12;
+      const auto z10 = t37 & y3;
+      const auto z11 = t33 & y4;
+      const auto z12 = t43 & y13;
+      const auto z13 = t40 & y5;
+      const auto z14 = t29 & y2;
+      const auto z15 = t42 & y9;
+      const auto z16 = t45 & y14;
+      const auto z17 = t41 & y8;
+
+      // Bottom linear transformation
+      const auto t46 = z15 ^ z16;
+      const auto t47 = z10 ^ z11;
+      const auto t48 = z5 ^ z13;
+      const auto t49 = z9 ^ z10;
+      const auto t50 = z2 ^ z12;
+      const auto t51 = z2 ^ z5;
+      const auto t52 = z7 ^ z8;
+      const auto t53 = z0 ^ z3;
+      const auto t54 = z6 ^ z7;
+      const auto t55 = z16 ^ z17;
+      const auto t56 = z12 ^ t48;
+      const auto t57 = t50 ^ t53;
+      const auto t58 = z4 ^ t46;
+      const auto t59 = z3 ^ t54;
+      const auto t60 = t46 ^ t57;
+      const auto t61 = z14 ^ t57;
+      const auto t62 = t52 ^ t58;
+      const auto t63 = t49 ^ t58;
+      const auto t64 = z4 ^ t59;
+      const auto t65 = t61 ^ t62;
+      const auto t66 = z1 ^ t63;
+      const auto s0 = t59 ^ t63;
+      const auto s6 = t56 ^ ~t62;
+      const auto s7 = t48 ^ ~t60;
+      const auto t67 = t64 ^ t65;
+      const auto s3 = t53 ^ t66;
+      const auto s4 = t51 ^ t66;
+      const auto s5 = t47 ^ t65;
+      const auto s1 = t64 ^ ~s3;
+      const auto s2 = t55 ^ ~t67;
+
+      q = Planes{s7, s6, s5, s4, s3, s2, s1, s0};
+    }
+
+    /// Inverse of the affine transformation of the S-Box (without its constant) applied to y ^ 0x63.
+    constexpr void inv_affine(Planes &q) {
+      const auto q0 = ~q[0], q1 = ~q[1], q2 = q[2], q3 = q[3], q4 = q[4], q5 = ~q[5], q6 = ~q[6], q7 = q[7];
+      q = Planes{q2 ^ q5 ^ q7, q3 ^ q6 ^ q0, q4 ^ q7 ^ q1, q5 ^ q0 ^ q2,
+                 q6 ^ q1 ^ q3, q7 ^ q2 ^ q4, q0 ^ q3 ^ q5, q1 ^ q4 ^ q6};
+    }
+
+    /// InvSubBytes Transformation - Inverse S-Box computed from the S-Box circuit.
+    /// \param q The bit planes to transform.
+    /// \remark The S-Box is an inversion in GF(2^8) followed by an affine transformation.
+    constexpr void inv_sub_bytes(Planes &q) {
+      inv_affine(q);
+      sub_bytes(q);
+      inv_affine(q);
+    }
+
+    /// ShiftRows Transformation: in each row r (16 bits), column c + r moves to column c.
+    constexpr void shift_rows(Planes &q) {
+      for(auto &x: q)
+        x = (x & 0x000000000000FFFF) |
+            (x & 0x00000000FFF00000) >> 4 | (x & 0x00000000000F0000) << 12 |
+            (x & 0x0000FF0000000000) >> 8 | (x & 0x000000FF00000000) << 8 |
+            (x & 0xF000000000000000) >> 12 | (x & 0x0FFF000000000000) << 4;
+    }
+
+    /// InvShiftRows Transformation: in each row r (16 bits), column c moves to column c + r.
+    constexpr void inv_shift_rows(Planes &q) {
+      for(auto &x: q)
+        x = (x & 0x000000000000FFFF) |
+            (x & 0x000000000FFF0000) << 4 | (x & 0x00000000F0000000) >> 12 |
+            (x & 0x0000FF0000000000) >> 8 | (x & 0x000000FF00000000) << 8 |
+            (x & 0x000F000000000000) << 12 | (x & 0xFFF0000000000000) >> 4;
+    }
+
+    /// Rotate the rows of each column: row r + n moves to row r.
+    constexpr std::uint64_t rotate_columns(std::uint64_t plane, int n) { return std::rotr(plane, 16 * n); }
+
+    /// Multiply each byte by x (i.e. 2) in GF(2^8).
+    constexpr Planes xtime(const Planes &q) {
+      return Planes{q[7], q[0] ^ q[7], q[1], q[2] ^ q[7], q[3] ^ q[7], q[4], q[5], q[6]};
+    }
+
+    /// MixColumns Transformation: 2.a ^ 3.b ^ c ^ d = 2.(a ^ b) ^ b ^ c ^ d, b, c and d being the next rows.
+    constexpr void mix_columns(Planes &q) {
+      Planes t;
+      for(std::size_t i = 0; i < 8; ++i) t[i] = q[i] ^ rotate_columns(q[i], 1);
+      t = xtime(t);
+      for(std::size_t i = 0; i < 8; ++i)
+        q[i] = t[i] ^ rotate_columns(q[i], 1) ^ rotate_columns(q[i], 2) ^ rotate_columns(q[i], 3);
+    }
+
+    /// InvMixColumns Transformation: MixColumns applied to a ^ 4.(a ^ c), c being two rows after.
+    /// \remark The Design of Rijndael, section 4.1.3.
+    constexpr void inv_mix_columns(Planes &q) {
+      Planes t;
+      for(std::size_t i = 0; i < 8; ++i) t[i] = q[i] ^ rotate_columns(q[i], 2);
+      t = xtime(xtime(t));
+      for(std::size_t i = 0; i < 8; ++i) q[i] ^= t[i];
+      mix_columns(q);
+    }
+
+    /// AddRoundKey Transformation.
+    constexpr void add_round_key(Planes &q, const Planes &key) {
+      for(std::size_t i = 0; i < 8; ++i) q[i] ^= key[i];
+    }
+
+    /// Get a round key as a block.
+    /// \param ekey Expanded key.
+    /// \param round The round.
+    /// \return The round key.
+    template<std::size_t NW>
+    constexpr Block round_key(const std::array<Word, NW> &ekey, std::size_t round) {
+      Block key;
+      for(std::size_t i = 0; i < 16; ++i) key[i] = ekey[round * 4 + i / 4][i % 4];
+      return key;
+    }
+
+    /// Convert the expanded key into bit planes (the same round key for each block).
+    /// \param ekey The expanded key.
+    /// \return The round keys.
+    template<std::size_t NW>
+    constexpr RoundKeys<NW> round_keys(const std::array<Word, NW> &ekey) {
+      RoundKeys<NW> keys;
+      for(std::size_t round = 0; round < keys.size(); ++round) {
+        auto key = round_key(ekey, round);
+        keys[round] = pack({key, key, key, key});
+        erase(key);
+      }
+      return keys;
+    }
+
+    /// Compute the round keys of 4 blocks, each one with its own key.
+    /// \param ekeys The expanded key of each block.
+    /// \return The round keys, as bit planes.
+    template<std::size_t NW>
+    constexpr RoundKeys<NW> round_keys(const std::array<const std::array<Word, NW> *, NB_BLOCKS> &ekeys) {
+      RoundKeys<NW> keys;
+      for(std::size_t round = 0; round < keys.size(); ++round) {
+        std::array<Block, NB_BLOCKS> key;
+        for(std::size_t b = 0; b < NB_BLOCKS; ++b) key[b] = round_key(*ekeys[b], round);
+        keys[round] = pack(key);
+        erase(key);
+      }
+      return keys;
+    }
+
+    /// Cipher - Encrypt 4 blocks (as bit planes).
+    template<std::size_t NK>
+    constexpr void cipher(Planes &q, const std::array<Planes, NK> &keys) {
+      constexpr auto n_r = NK - 1;
+      add_round_key(q, keys[0]);
+      for(std::size_t round = 1; round < n_r; ++round) {
+        sub_bytes(q);
+        shift_rows(q);
+        mix_columns(q);
+        add_round_key(q, keys[round]);
+      }
+      sub_bytes(q);
+      shift_rows(q);
+      add_round_key(q, keys[n_r]);
+    }
+
+    /// InvCipher - Decrypt 4 blocks (as bit planes).
+    template<std::size_t NK>
+    constexpr void inv_cipher(Planes &q, const std::array<Planes, NK> &keys) {
+      constexpr auto n_r = NK - 1;
+      add_round_key(q, keys[n_r]);
+      for(std::size_t round = n_r - 1; round >= 1; --round) {
+        inv_shift_rows(q);
+        inv_sub_bytes(q);
+        add_round_key(q, keys[round]);
+        inv_mix_columns(q);
+      }
+      inv_shift_rows(q);
+      inv_sub_bytes(q);
+      add_round_key(q, keys[0]);
+    }
+
+    /// SubWord Transformation in constant-time (for the key schedule).
+    /// \param word Word to transform.
+    /// \return Transformed Word.
+    constexpr Word sub_word(const Word &word) {
+      Planes q{};
+      for(std::size_t i = 0; i < 8; ++i)
+        for(std::size_t j = 0; j < 4; ++j) q[i] |= std::uint64_t{static_cast<Byte>(word[j] >> i & 1)} << j;
+      sub_bytes(q);
+      Word result{};
+      for(std::size_t i = 0; i < 8; ++i)
+        for(std::size_t j = 0; j < 4; ++j) result[j] |= static_cast<Byte>((q[i] >> j & 1) << i);
+      erase(q);
+      return result;
+    }
+
+    /// Decrypt in-place using CTR (Counter) mode, 4 counter blocks at a time.
+    /// \param data bytes to be decrypted with AES.
+    /// \param ekey Expanded key.
+    /// \param nonce The random nonce of the stream.
+    /// \param offset Position of the first byte in the stream.
+    template<std::size_t NW>
+    inline void decrypt_ctr(Byte *data, std::size_t size, const std::array<Word, NW> &ekey, const Nonce &nonce,
+                            std::size_t offset) {
+      auto keys = round_keys(ekey);
+      Planes q;
+      std::array<Block, NB_BLOCKS> stream;
+      auto block = offset / 16;
+      auto skip = offset % 16;
+      while(size > 0) {
+        std::array<Block, NB_BLOCKS> counters;
+        for(std::size_t b = 0; b < NB_BLOCKS; ++b) counters[b] = counter_block(nonce, block + b);
+        q = pack(counters);
+        cipher(q, keys);
+        stream = unpack(q);
+        for(std::size_t b = 0; b < NB_BLOCKS && size > 0; ++b) {
+          const auto nb_bytes = std::min(16 - skip, size);
+          // Combine the cipher and the plain bytes
+          for(std::size_t j = 0; j < nb_bytes; ++j) data[j] ^= stream[b][skip + j];
+          data += nb_bytes;
+          size -= nb_bytes;
+          skip = 0;
+        }
+        block += NB_BLOCKS;
+      }
+      erase(q);
+      erase(stream);
+      erase(keys);
+    }
+
+    /// Encrypt blocks in-place, each one with its own key, 4 at a time.
+    /// \param blocks The blocks to encrypt.
+    /// \param ekeys The expanded key of each block.
+    /// \param count Number of blocks.
+    template<std::size_t NW>
+    inline void encrypt_blocks(Block *blocks, const std::array<Word, NW> *const *ekeys, std::size_t count) {
+      for(std::size_t first = 0; first < count; first += NB_BLOCKS) {
+        const auto n = std::min(NB_BLOCKS, count - first);
+        // The missing blocks of the last group are copies of its first block
+        std::array<Block, NB_BLOCKS> group;
+        std::array<const std::array<Word, NW> *, NB_BLOCKS> keys_of_group;
+        for(std::size_t b = 0; b < NB_BLOCKS; ++b) {
+          group[b] = blocks[first + (b < n ? b : 0)];
+          keys_of_group[b] = ekeys[first + (b < n ? b : 0)];
+        }
+        auto keys = round_keys(keys_of_group);
+        auto q = pack(group);
+        cipher(q, keys);
+        group = unpack(q);
+        std::copy_n(group.begin(), n, blocks + first);
+        erase(group);
+        erase(q);
+        erase(keys);
+      }
+    }
+
+    /// Decrypt blocks in-place, 4 at a time.
+    /// \param data The blocks to decrypt.
+    /// \param nb_blocks Number of blocks.
+    /// \param ekey Expanded key.
+    template<std::size_t NW>
+    inline void decrypt_blocks(Byte *data, std::size_t nb_blocks, const std::array<Word, NW> &ekey) {
+      auto keys = round_keys(ekey);
+      Planes q;
+      std::array<Block, NB_BLOCKS> group;
+      for(std::size_t first = 0; first < nb_blocks; first += NB_BLOCKS) {
+        const auto n = std::min(NB_BLOCKS, nb_blocks - first);
+        // The missing blocks of the last group are copies of its first block
+        for(std::size_t b = 0; b < NB_BLOCKS; ++b)
+          std::copy_n(data + (first + (b < n ? b : 0)) * 16, 16, group[b].begin());
+        q = pack(group);
+        inv_cipher(q, keys);
+        group = unpack(q);
+        for(std::size_t b = 0; b < n; ++b) std::copy_n(group[b].begin(), 16, data + (first + b) * 16);
+      }
+      erase(group);
+      erase(q);
+      erase(keys);
+    }
+  }
+
+  namespace details {
+    template<>
+    class EncryptionSession<AesBackend::BITSLICED> {
+    public:
+      template<std::size_t NW>
+      [[nodiscard]] constexpr Block operator()(const Block &block, const std::array<Word, NW> &ekey) const {
+        auto keys = bitsliced::round_keys(ekey);
+        auto q = bitsliced::pack({block, block, block, block});
+        bitsliced::cipher(q, keys);
+        const auto encrypted = bitsliced::unpack(q)[0];
+        erase(keys);
+        return encrypted;
+      }
+    };
+
+    template<>
+    class DecryptionSession<AesBackend::BITSLICED> {
+    public:
+      template<std::size_t NW>
+      [[nodiscard]] constexpr Block operator()(const Block &block, const std::array<Word, NW> &ekey) const {
+        auto keys = bitsliced::round_keys(ekey);
+        auto q = bitsliced::pack({block, block, block, block});
+        bitsliced::inv_cipher(q, keys);
+        const auto decrypted = bitsliced::unpack(q)[0];
+        erase(keys);
+        return decrypted;
+      }
+    };
   }
 
+  // ------------------------------------------------------------------
+  // Compile-time encryption
+  // ------------------------------------------------------------------
+
+  namespace details::compile_time {
+    /// Plain S-Box and T-tables of the encryption (one for each row, as little-endian words).
+    /// \remark Built-in arrays: at compile time, each call to std::array::operator[] has to be evaluated.
+    struct Tables {
+      Byte sbox[256];
+      std::uint32_t te[4][256];
+    };
+
+    /// Decode the S-Box and compute the T-tables.
+    /// \return The plain tables.
+    consteval Tables make_tables() {
+      const SBox s{details::sbox};
+      Tables tables{};
+      for(std::size_t x = 0; x < 256; ++x) {
+        const Byte b = s[static_cast<Byte>(x)];
+        const auto column = pack(xtime(b), b, b, xtime(b) ^ b);
+        tables.sbox[x] = b;
+        for(std::size_t r = 0; r < 4; ++r) tables.te[r][x] = std::rotl(column, static_cast<int>(r * 8));
+      }
+      return tables;
+    }
+
+    /// Plain tables, computed once per translation unit.
+    /// \remark They are only read by consteval functions, so they are never emitted in the binary
+    /// (unlike namespace-scope constants that GCC keeps without optimization).
+    struct Plain {
+      static constexpr Tables tables = make_tables();
+    };
+
+    /// SubWord Transformation with the plain S-Box.
+    /// \param word Word to transform.
+    /// \return Transformed Word.
+    constexpr Word sub_word(const Word &word) {
+      const auto &sbox = Plain::tables.sbox;
+      return Word{sbox[word[0]], sbox[word[1]], sbox[word[2]], sbox[word[3]]};
+    }
+
+    /// Cipher using the plain T-tables.
+    /// \param block Block to be encrypted.
+    /// \param rk Round keys (expanded key packed as little-endian words).
+    /// \return The encrypted block.
+    template<std::size_t NW>
+    consteval Block cipher(const Block &block, const std::uint32_t (&rk)[NW]) {
+      constexpr auto n_r = n_rounds<NW>();
+      const auto &[sbox, te] = Plain::tables;
+      std::uint32_t s[4], t[4];
+      for(std::size_t c = 0; c < 4; ++c)
+        s[c] = pack(block[c * 4], block[c * 4 + 1], block[c * 4 + 2], block[c * 4 + 3]) ^ rk[c];
+
+      for(std::size_t round = 1; round < n_r; ++round) {
+        for(std::size_t c = 0; c < 4; ++c)
+          t[c] = te[0][s[c] & 0xFF] ^ te[1][s[(c + 1) % 4] >> 8 & 0xFF] ^
+                 te[2][s[(c + 2) % 4] >> 16 & 0xFF] ^ te[3][s[(c + 3) % 4] >> 24] ^ rk[round * 4 + c];
+        for(std::size_t c = 0; c < 4; ++c) s[c] = t[c];
+      }
+
+      Block encrypted;
+      for(std::size_t c = 0; c < 4; ++c)
+        for(std::size_t r = 0; r < 4; ++r)
+          encrypted[c * 4 + r] = sbox[s[(c + r) % 4] >> r * 8 & 0xFF] ^ static_cast<Byte>(rk[n_r * 4 + c] >> r * 8);
+      return encrypted;
+    }
+
+    /// Encrypt using CTR (Counter) mode with an expanded key.
+    /// \param data bytes to be encrypted.
+    /// \param ekey Expanded key.
+    /// \param nonce The random nonce of the stream.
+    /// \return The encrypted bytes.
+    template<std::size_t NW, std::size_t N>
+    consteval std::array<Byte, N> encrypt_ctr(const std::array<Byte, N> &data, const std::array<Word, NW> &ekey,
+                                              const Nonce &nonce) {
+      std::uint32_t rk[NW]{};
+      for(std::size_t i = 0; i < NW; ++i) rk[i] = pack(ekey[i]);
+
+      std::array<Byte, N> encrypted{};
+      for(std::size_t i = 0; i < N; i += 16) {
+        const auto encrypted_ctr = cipher(counter_block(nonce, i / 16), rk);
+        // Combine the cipher and the plain bytes
+        for(std::size_t j = 0; j < 16 && i + j < N; ++j) encrypted[i + j] = data[i + j] ^ encrypted_ctr[j];
+      }
+      return encrypted;
+    }
+
+    /// Encrypt using CTR (Counter) mode.
+    /// \tparam Policy Size of the key and number of rounds.
+    /// \param data bytes to be encrypted.
+    /// \param key AES key.
+    /// \param nonce The random nonce of the stream.
+    /// \return The encrypted bytes.
+    /// \remark The key is expanded once for the whole array.
+    template<typename Policy, std::size_t N>
+    consteval std::array<Byte, N> encrypt_ctr(const std::array<Byte, N> &data, const typename Policy::Key &key,
+                                              const Nonce &nonce) {
+      return encrypt_ctr(data, key_expansion<Policy>(key, sub_word), nonce);
+    }
+
+    /// Obfuscate an expanded key, as a flat buffer (the key of the obfuscations is computed only once).
+    /// \param ekey Expanded key.
+    /// \param algos Set of algorithms used for the obfuscation.
+    /// \return The obfuscated expanded key, deobfuscated by the constructor of AesContext.
+    template<std::size_t NW>
+    consteval std::array<Word, NW> obfuscate(const std::array<Word, NW> &ekey, const Obfuscations &algos) {
+      std::array<Byte, 4 * NW> bytes{};
+      for(std::size_t i = 0; i < NW; ++i) std::copy(ekey[i].begin(), ekey[i].end(), bytes.begin() + i * 4);
+      algos.encode(0, bytes.begin(), bytes.end());
+      std::array<Word, NW> obfuscated{};
+      for(std::size_t i = 0; i < NW; ++i) std::copy_n(bytes.begin() + i * 4, 4, obfuscated[i].begin());
+      return obfuscated;
+    }
+  }
+
+  // ------------------------------------------------------------------
+  // Context
+  // ------------------------------------------------------------------
+
+  /// AES context: the key schedule (expanded key) is computed once and reused for each block.
+  /// \tparam Policy Size of the key and number of rounds.
+  /// \remark The expanded key is erased (through a volatile pointer at runtime) when the context is destroyed.
+  template<typename Policy = DefaultAesPolicy>
+  class AesContext {
+  public:
+    /// Construct a context by expanding a key.
+    /// \param key AES key.
+    /// \remark The key schedule is computed in constant-time (without table lookups depending on the key).
+    constexpr explicit AesContext(const typename Policy::Key &key)
+    : ekey_{details::key_expansion<Policy>(key, details::bitsliced::sub_word)} {}
+    /// Construct a context from a key schedule computed beforehand (such as at compile-time) and obfuscated.
+    /// \param ekey The obfuscated expanded key.
+    /// \param algos Set of algorithms used for the obfuscation of the expanded key.
+    /// \remark The expanded key is only deobfuscated, in place: there is no key schedule.
+    constexpr AesContext(const typename Policy::EKey &ekey, const Obfuscations &algos) noexcept {
+      // Decoded in one pass (the key of the obfuscations is computed once)
+      std::array<Byte, 16 * (Policy::rounds + 1)> bytes;
+      for(std::size_t i = 0; i < ekey.size(); ++i) std::copy(ekey[i].begin(), ekey[i].end(), bytes.begin() + i * 4);
+      algos.decode(0, bytes.begin(), bytes.end());
+      for(std::size_t i = 0; i < ekey_.size(); ++i) std::copy_n(bytes.begin() + i * 4, 4, ekey_[i].begin());
+      details::erase(bytes);
+    }
+    /// Destruct the context and erase the expanded key.
+    constexpr ~AesContext() noexcept { details::erase(ekey_); }
+
+    // The expanded key is a secret: it is not copied
+    AesContext(const AesContext &) = delete;
+    AesContext &operator=(const AesContext &) = delete;
+
+    /// Get the expanded key.
+    /// \return The expanded key.
+    [[nodiscard]] constexpr const typename Policy::EKey &ekey() const noexcept { return ekey_; }
+
+  private:
+    typename Policy::EKey ekey_;
+  };
+
   // ------------------------------------------------------------------
   // Public functions
   // ------------------------------------------------------------------
 
+  /// Encrypt a block (128-bit) with a context.
+  /// \tparam backend Implementation of the cipher.
+  /// \param block Block to be encrypted with AES.
+  /// \param context AES context (expanded key).
+  /// \return The encrypted block.
+  template<AesBackend backend = default_aes_backend, typename Policy>
+  [[nodiscard]] constexpr Block encrypt(const Block &block, const AesContext<Policy> &context) {
+    return details::EncryptionSession<backend>{}(block, context.ekey());
+  }
+
   /// Encrypt a block (128-bit) with a key.
+  /// \tparam backend Implementation of the cipher.
   /// \param block Block to be encrypted with AES.
   /// \param key AES key.
   /// \return The encrypted block.
+  /// \remark To encrypt several blocks, construct an AesContext once instead.
+  template<AesBackend backend = default_aes_backend>
   [[nodiscard]] constexpr Block encrypt(const Block &block, const Key &key) {
-    using namespace details;
-
-    const auto ekey = key_expansion(key);
-    State state = add_round_key(to_state(block), ekey, 0);
-    for(std::size_t round = 1; round < n_rounds(); ++round)
-      state = add_round_key(mix_columns(shift_rows(sub_bytes(state))), ekey, round);
-    state = add_round_key(shift_rows(sub_bytes(state)), ekey, n_rounds());
-    return to_block(state);
+    return encrypt<backend>(block, AesContext{key});
   }
 
   /// Encrypt an array of bytes (128-bit) with a key.
@@ -386,85 +1591,269 @@ namespace andrivet::advobfuscator {
     return encrypt(std::to_array(block), std::to_array(key));
   }
 
+  /// Decrypt (at runtime) a block of bytes with a context.
+  /// \tparam backend Implementation of the cipher.
+  /// \param block bytes to be decrypted with AES.
+  /// \param context AES context (expanded key).
+  /// \return The decrypted block.
+  template<AesBackend backend = default_aes_backend, typename Policy>
+  [[nodiscard]] inline Block decrypt(const Block &block, const AesContext<Policy> &context) {
+    return details::DecryptionSession<backend>{}(block, context.ekey());
+  }
+
   /// Decrypt (at runtime) a block of bytes with a key.
+  /// \tparam backend Implementation of the cipher.
   /// \param block bytes to be decrypted with AES.
   /// \param key AES key.
   /// \return The decrypted block.
+  /// \remark To decrypt several blocks, construct an AesContext once instead.
+  template<AesBackend backend = default_aes_backend>
   [[nodiscard]] inline Block decrypt(const Block &block, const Key &key) {
-    using namespace details;
-    const auto ekey = key_expansion(key);
-
-    State state = add_round_key(to_state(block), ekey, n_rounds());
-    for(std::size_t round = n_rounds() - 1; round >= 1; --round)
-      state = inv_mix_columns(add_round_key(inv_sub_bytes(inv_shift_rows(state)), ekey, round));
-    state = add_round_key(inv_sub_bytes(inv_shift_rows(state)), ekey, 0);
-    return to_block(state);
+    return decrypt<backend>(block, AesContext{key});
   }
 
   /// Encrypt in-place a string with a key using CTR (Counter) code (using a nonce)
+  /// \tparam backend Implementation of the cipher.
+  /// \tparam Policy Size of the key and number of rounds.
   /// \param block bytes to be encrypted with AES. The number of bytes does not need to be a multiple of 128.
   /// \param key AES key.
   /// \param nonce The random nonce to initialize the stream.
-  template<std::size_t N>
-  [[nodiscard]] consteval std::array<Byte, N> encrypt_ctr(const std::array<Byte, N> &block, const Key &key, const Nonce &nonce) {
-    Block ctr{
-      nonce[0], nonce[1], nonce[2], nonce[3], nonce[4], nonce[5], nonce[6], nonce[7],
-      0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-    };
+  /// \remark At compile time, all backends give the same result: the encryption uses plain tables, cheaper to
+  /// evaluate than the obfuscated ones, and that are not emitted in the binary.
+  template<AesBackend backend = default_aes_backend, typename Policy = DefaultAesPolicy, std::size_t N>
+  [[nodiscard]] consteval std::array<Byte, N> encrypt_ctr(const std::array<Byte, N> &block,
+                                                          const typename Policy::Key &key, const Nonce &nonce) {
+    return details::compile_time::encrypt_ctr<Policy>(block, key, nonce);
+  }
 
-    std::array<Byte, N> encrypted;
-    const auto nb_whole_blocks = N / 16;
-    const auto nb_bytes_last_block = N % 16;
-    for(std::size_t i = 0; i < nb_whole_blocks; ++i) {
-      auto encrypted_ctr = encrypt(ctr, key);
-      // Combine the cipher and the plain bytes
-      for(std::size_t j = 0; j < 16; ++j) encrypted[i * 16 + j] = block[i * 16 + j] ^ encrypted_ctr[j];
-      // Update the counter
-      for(std::size_t j = 0; j < 8; ++j) ctr[8 + j] = static_cast<Byte>((i >> j * 8) & 0x00000000000000FF);
+  /// Decrypt in-place a string with a context using CTR (Counter) code (using a nonce)
+  /// \tparam backend Implementation of the cipher.
+  /// \param data bytes to be decrypted with AES. The number of bytes does not need to be a multiple of 128.
+  /// \param context AES context (expanded key).
+  /// \param nonce The random nonce to initialize the stream.
+  /// \param offset Position of the first byte in the stream (0 by default). It does not need to be a multiple of 128.
+  template<AesBackend backend = default_aes_backend, typename Policy>
+  inline void decrypt_ctr(Byte *data, size_t size, const AesContext<Policy> &context, const Nonce &nonce,
+                          std::size_t offset = 0) {
+    using namespace details;
+
+#if defined(ADVOBFUSCATOR_X86_64)
+    if constexpr(backend == AesBackend::AESNI) {
+      if(cpu::has_aesni()) {
+        aesni::decrypt_ctr(data, size, context.ekey(), nonce, offset);
+        return;
+      }
     }
+#endif
 
-    const auto encrypted_ctr = encrypt(ctr, key);
-    for(std::size_t j = 0; j < nb_bytes_last_block; ++j)
-      encrypted[nb_whole_blocks * 16 + j] = block[nb_whole_blocks * 16 + j] ^ encrypted_ctr[j];
+    // Without AES instructions, AESNI uses the bitsliced implementation (faster than T-tables for streams)
+    if constexpr(backend == AesBackend::BITSLICED || backend == AesBackend::AESNI) {
+      bitsliced::decrypt_ctr(data, size, context.ekey(), nonce, offset);
+      return;
+    }
 
-    return encrypted;
+    const EncryptionSession<backend> session;
+    auto block = offset / 16;
+    auto skip = offset % 16;
+    while(size > 0) {
+      const auto encrypted_ctr = session(counter_block(nonce, block++), context.ekey());
+      const auto nb_bytes = std::min(16 - skip, size);
+      // Combine the cipher and the plain bytes
+      for(std::size_t j = 0; j < nb_bytes; ++j) data[j] = data[j] ^ encrypted_ctr[skip + j];
+      data += nb_bytes;
+      size -= nb_bytes;
+      skip = 0;
+    }
   }
 
   /// Decrypt in-place a string with a key using CTR (Counter) code (using a nonce)
+  /// \tparam backend Implementation of the cipher.
+  /// \tparam Policy Size of the key and number of rounds.
   /// \param data bytes to be decrypted with AES. The number of bytes does not need to be a multiple of 128.
   /// \param key AES key.
   /// \param nonce The random nonce to initialize the stream.
-  inline void decrypt_ctr(Byte *data, size_t size, const Key &key, const Nonce &nonce) {
-    Block ctr{
-        nonce[0], nonce[1], nonce[2], nonce[3], nonce[4], nonce[5], nonce[6], nonce[7],
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-    };
-
-    const auto nb_whole_blocks = size / 16;
-    const auto nb_bytes_last_block = size % 16;
-    for(std::size_t i = 0; i < nb_whole_blocks; ++i) {
-      auto encrypted_ctr = encrypt(ctr, key);
-      // Combine the cipher and the plain bytes
-      for(std::size_t j = 0; j < 16; ++j) data[i * 16 + j] = data[i * 16 + j] ^ encrypted_ctr[j];
-      // Update the counter
-      for(std::size_t j = 0; j < 8; ++j) ctr[8 + j] = static_cast<Byte>((i >> j * 8) & 0x00000000000000FF);
-    }
-
-    const auto encrypted_ctr = encrypt(ctr, key);
-    for(std::size_t j = 0; j < nb_bytes_last_block; ++j)
-      data[nb_whole_blocks * 16 + j] = data[nb_whole_blocks * 16 + j] ^ encrypted_ctr[j];
+  /// \param offset Position of the first byte in the stream (0 by default). It does not need to be a multiple of 128.
+  /// \remark The key is expanded only once for the whole string.
+  template<AesBackend backend = default_aes_backend, typename Policy = DefaultAesPolicy>
+  inline void decrypt_ctr(Byte *data, size_t size, const typename Policy::Key &key, const Nonce &nonce,
+                          std::size_t offset = 0) {
+    decrypt_ctr<backend>(data, size, AesContext<Policy>{key}, nonce, offset);
   }
 
   /// Decrypt out-of-place a string with a key using CTR (Counter) code (using a nonce)
+  /// \tparam backend Implementation of the cipher.
+  /// \tparam Policy Size of the key and number of rounds.
   /// \param data bytes to be decrypted with AES. The number of bytes does not need to be a multiple of 128.
   /// \param key AES key.
   /// \param nonce The random nonce to initialize the stream.
   /// \return The decrypted bytes
-  template<std::size_t N>
-  [[nodiscard]] consteval std::array<Byte, N> encrypt_ctr(const Byte (&data)[N], const Key &key, const Nonce &nonce) {
+  template<AesBackend backend = default_aes_backend, typename Policy = DefaultAesPolicy, std::size_t N>
+  [[nodiscard]] consteval std::array<Byte, N> encrypt_ctr(const Byte (&data)[N], const typename Policy::Key &key,
+                                                          const Nonce &nonce) {
     std::array<Byte, N> buffer{};
     std::copy(data, data + N, buffer.begin());
-    return encrypt_ctr(buffer, key, nonce);
+    return encrypt_ctr<backend, Policy>(buffer, key, nonce);
+  }
+
+  // ------------------------------------------------------------------
+  // Batches
+  // ------------------------------------------------------------------
+
+  namespace details {
+    /// Encrypt blocks in-place, each one with its own key.
+    /// \tparam backend Implementation of the cipher.
+    /// \param blocks The blocks to encrypt.
+    /// \param ekeys The expanded key of each block.
+    /// \param count Number of blocks.
+    template<AesBackend backend, std::size_t NW>
+    inline void encrypt_blocks(Block *blocks, const std::array<Word, NW> *const *ekeys, std::size_t count) {
+#if defined(ADVOBFUSCATOR_X86_64)
+      if constexpr(backend == AesBackend::AESNI) {
+        if(cpu::has_aesni()) {
+          aesni::encrypt_blocks(blocks, ekeys, count);
+          return;
+        }
+      }
+#endif
+
+      if constexpr(backend == AesBackend::BITSLICED || backend == AesBackend::AESNI) {
+        bitsliced::encrypt_blocks(blocks, ekeys, count);
+        return;
+      }
+
+      // The tables are decoded once for all the blocks
+      const EncryptionSession<backend> session;
+      for(std::size_t i = 0; i < count; ++i) blocks[i] = session(blocks[i], *ekeys[i]);
+    }
+  }
+
+  /// A stream of data to decrypt in a batch (CTR mode).
+  /// \tparam Policy Size of the key and number of rounds.
+  template<typename Policy = DefaultAesPolicy>
+  struct CtrStream {
+    /// Bytes to be decrypted in-place.
+    Byte *data = nullptr;
+    /// Number of bytes.
+    std::size_t size = 0;
+    /// AES context (expanded key) of the stream.
+    const AesContext<Policy> *context = nullptr;
+    /// The nonce of the stream.
+    const Nonce *nonce = nullptr;
+  };
+
+  /// Decrypt in-place several streams together using CTR (Counter) mode.
+  /// \tparam backend Implementation of the cipher.
+  /// \param streams The streams to decrypt. Each one has its own key and nonce.
+  /// \param count Number of streams.
+  /// \remark The counter blocks of all the streams are interleaved and encrypted by groups: with AES instructions,
+  /// the pipeline stays full even when each stream is short, and the tables are decoded once for all the streams.
+  template<AesBackend backend = default_aes_backend, typename Policy>
+  inline void decrypt_ctr_batch(const CtrStream<Policy> *streams, std::size_t count) {
+    using namespace details;
+
+    // Number of counter blocks encrypted together
+    static constexpr std::size_t BATCH = 32;
+    std::array<Block, BATCH> blocks;
+    std::array<const typename Policy::EKey *, BATCH> ekeys;
+    std::array<std::pair<std::size_t, std::size_t>, BATCH> targets; // Stream and position of each block
+    std::size_t nb_blocks = 0;
+
+    const auto combine = [&] {
+      encrypt_blocks<backend>(blocks.data(), ekeys.data(), nb_blocks);
+      for(std::size_t i = 0; i < nb_blocks; ++i) {
+        const auto &[stream, pos] = targets[i];
+        const auto nb_bytes = std::min<std::size_t>(16, streams[stream].size - pos);
+        for(std::size_t j = 0; j < nb_bytes; ++j) streams[stream].data[pos + j] ^= blocks[i][j];
+      }
+      nb_blocks = 0;
+    };
+
+    for(std::size_t s = 0; s < count; ++s) {
+      for(std::size_t pos = 0; pos < streams[s].size; pos += 16) {
+        blocks[nb_blocks] = counter_block(*streams[s].nonce, pos / 16);
+        ekeys[nb_blocks] = &streams[s].context->ekey();
+        targets[nb_blocks++] = {s, pos};
+        if(nb_blocks == BATCH) combine();
+      }
+    }
+    if(nb_blocks > 0) combine();
+    erase(blocks);
+  }
+
+  // ------------------------------------------------------------------
+  // Block modes
+  // ------------------------------------------------------------------
+
+  namespace details {
+    /// Decrypt blocks in-place with the same key.
+    /// \tparam backend Implementation of the cipher.
+    /// \param data The blocks to decrypt.
+    /// \param nb_blocks Number of blocks.
+    /// \param ekey Expanded key.
+    template<AesBackend backend, std::size_t NW>
+    inline void decrypt_blocks(Byte *data, std::size_t nb_blocks, const std::array<Word, NW> &ekey) {
+#if defined(ADVOBFUSCATOR_X86_64)
+      if constexpr(backend == AesBackend::AESNI) {
+        if(cpu::has_aesni()) {
+          aesni::decrypt_blocks(data, nb_blocks, ekey);
+          return;
+        }
+      }
+#endif
+
+      if constexpr(backend == AesBackend::BITSLICED || backend == AesBackend::AESNI) {
+        bitsliced::decrypt_blocks(data, nb_blocks, ekey);
+      } else if constexpr(backend == AesBackend::TTABLE) {
+        // The tables are decoded, and the round keys of the equivalent inverse cipher computed, once for all the blocks
+        DecryptionSession<backend>{}(data, nb_blocks, ekey);
+      } else {
+        const DecryptionSession<backend> session;
+        Block block;
+        for(std::size_t i = 0; i < nb_blocks; ++i, data += 16) {
+          std::copy_n(data, 16, block.begin());
+          block = session(block, ekey);
+          std::copy_n(block.begin(), 16, data);
+        }
+        erase(block);
+      }
+    }
+  }
+
+  /// Decrypt in-place blocks with a context (ECB mode: each block is decrypted independently).
+  /// \tparam backend Implementation of the cipher.
+  /// \param data bytes to be decrypted with AES.
+  /// \param size Number of bytes. It has to be a multiple of 16; the remaining bytes, if any, are not decrypted.
+  /// \param context AES context (expanded key).
+  /// \remark With AES instructions or bitsliced, several blocks are decrypted in parallel.
+  template<AesBackend backend = default_aes_backend, typename Policy>
+  inline void decrypt_blocks(Byte *data, std::size_t size, const AesContext<Policy> &context) {
+    details::decrypt_blocks<backend>(data, size / 16, context.ekey());
+  }
+
+  /// Decrypt in-place blocks with a context using CBC (Cipher Block Chaining) mode.
+  /// \tparam backend Implementation of the cipher.
+  /// \param data bytes to be decrypted with AES.
+  /// \param size Number of bytes. It has to be a multiple of 16; the remaining bytes, if any, are not decrypted.
+  /// \param context AES context (expanded key).
+  /// \param iv The initialization vector.
+  /// \remark Contrary to the encryption, the decryption of CBC does not depend on the previous plain blocks:
+  /// the blocks are decrypted by groups, then combined with the previous cipher blocks.
+  template<AesBackend backend = default_aes_backend, typename Policy>
+  inline void decrypt_cbc(Byte *data, std::size_t size, const AesContext<Policy> &context, const Block &iv) {
+    // Number of blocks decrypted together
+    static constexpr std::size_t BATCH = 256;
+    std::array<Byte, BATCH * 16> cipher; // Cipher blocks of the group, still needed after their decryption
+    auto previous = iv;
+    for(std::size_t nb_blocks = size / 16; nb_blocks > 0;) {
+      const auto n = std::min(BATCH, nb_blocks);
+      std::copy_n(data, n * 16, cipher.begin());
+      details::decrypt_blocks<backend>(data, n, context.ekey());
+      for(std::size_t j = 0; j < 16; ++j) data[j] ^= previous[j];
+      for(std::size_t j = 16; j < n * 16; ++j) data[j] ^= cipher[j - 16];
+      std::copy_n(cipher.begin() + (n - 1) * 16, 16, previous.begin());
+      data += n * 16;
+      nb_blocks -= n;
+    }
   }
 }
 
@@ -0,0 +1,156 @@
+// ADVobfuscator - Multi-threaded AES-CTR decryption of large buffers
+//
+// Copyright (c) 2025, Sebastien Andrivet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+// following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+// disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+// following disclaimer in the documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+// products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+// USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Get latest version on https://github.com/andrivet/ADVobfuscator
+
+#ifndef ADVOBFUSCATOR_AES_PARALLEL_H
+#define ADVOBFUSCATOR_AES_PARALLEL_H
+
+#include <cstddef>
+#include <algorithm>
+#include <concepts>
+#include <numeric>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "aes.h"
+
+namespace andrivet::advobfuscator {
+
+  /// Below this size (in bytes), the decryption stays serial: starting threads costs more than it saves.
+  static constexpr std::size_t parallel_threshold{1024 * 1024};
+  /// Size (in bytes) of the chunks decrypted by each task. It is a multiple of the size of a block (128-bit).
+  static constexpr std::size_t parallel_chunk_size{256 * 1024};
+
+  /// An executor runs tasks, possibly concurrently: executor(nb_tasks, task) calls task(i) for each i in
+  /// [0, nb_tasks) and returns when all the tasks are completed.
+  template<typename E>
+  concept AesExecutor = requires(E &&executor, void (*task)(std::size_t)) {
+    executor(std::size_t{}, task);
+  };
+
+  /// A standard execution policy (such as std::execution::par) accepted by std::for_each.
+  /// \remark <execution> is not included here: with libstdc++ and oneTBB, including it alone requires to link with TBB.
+  template<typename P>
+  concept AesExecutionPolicy = requires(P &&policy, std::size_t *first, void (*task)(std::size_t)) {
+    std::for_each(std::forward<P>(policy), first, first, task);
+  };
+
+  /// Executor running the tasks on a set of threads (the current thread and nb_threads - 1 new threads).
+  class ThreadExecutor {
+  public:
+    /// Construct an executor.
+    /// \param nb_threads Maximal number of threads (by default, the number of hardware threads).
+    explicit ThreadExecutor(std::size_t nb_threads = std::thread::hardware_concurrency()) noexcept
+    : nb_threads_{std::max<std::size_t>(nb_threads, 1)} {}
+
+    /// Run the tasks. Each thread runs the tasks i, i + nb_threads, i + 2 * nb_threads, ...
+    /// \param nb_tasks Number of tasks.
+    /// \param task The task to run, called with the index of the task.
+    template<typename Task>
+    void operator()(std::size_t nb_tasks, Task &&task) const {
+      const auto nb_threads = std::min(nb_threads_, nb_tasks);
+      const auto run = [&](std::size_t first) {
+        for(std::size_t i = first; i < nb_tasks; i += nb_threads) task(i);
+      };
+
+      std::vector<std::jthread> threads;
+      threads.reserve(nb_threads);
+      for(std::size_t t = 1; t < nb_threads; ++t) threads.emplace_back(run, t);
+      run(0);
+      // The threads are joined when they are destroyed
+    }
+
+  private:
+    std::size_t nb_threads_;
+  };
+
+  /// Decrypt in-place a large buffer with a context using CTR (Counter) mode, by chunks run by an executor.
+  /// \tparam backend Implementation of the cipher.
+  /// \param data bytes to be decrypted with AES. The number of bytes does not need to be a multiple of 128.
+  /// \param size Number of bytes to decrypt.
+  /// \param context AES context (expanded key), shared by all the tasks.
+  /// \param nonce The random nonce to initialize the stream.
+  /// \param executor The executor running the tasks.
+  /// \param offset Position of the first byte in the stream (0 by default).
+  /// \param threshold Below this size, the buffer is decrypted serially on the current thread.
+  /// \remark The chunks are aligned on the stream (not on data), so each one starts with its own counter block.
+  template<AesBackend backend = default_aes_backend, typename Policy, AesExecutor Executor>
+  void decrypt_ctr_parallel(Byte *data, std::size_t size, const AesContext<Policy> &context, const Nonce &nonce,
+                            Executor &&executor, std::size_t offset = 0,
+                            std::size_t threshold = parallel_threshold) {
+    if(size < threshold) {
+      decrypt_ctr<backend>(data, size, context, nonce, offset);
+      return;
+    }
+    if(size == 0) return;
+
+    const auto first = offset / parallel_chunk_size;
+    const auto last = (offset + size - 1) / parallel_chunk_size;
+    executor(last - first + 1, [&](std::size_t i) {
+      const auto begin = std::max(offset, (first + i) * parallel_chunk_size);
+      const auto end = std::min(offset + size, (first + i + 1) * parallel_chunk_size);
+      decrypt_ctr<backend>(data + (begin - offset), end - begin, context, nonce, begin);
+    });
+  }
+
+  /// Decrypt in-place a large buffer with a context using CTR (Counter) mode, by chunks run by a standard
+  /// execution policy (such as std::execution::par).
+  /// \tparam backend Implementation of the cipher.
+  /// \param data bytes to be decrypted with AES. The number of bytes does not need to be a multiple of 128.
+  /// \param size Number of bytes to decrypt.
+  /// \param context AES context (expanded key), shared by all the tasks.
+  /// \param nonce The random nonce to initialize the stream.
+  /// \param policy The execution policy.
+  /// \param offset Position of the first byte in the stream (0 by default).
+  /// \param threshold Below this size, the buffer is decrypted serially on the current thread.
+  /// \remark The caller includes <execution>. With libstdc++, the parallel policies require to link with TBB.
+  template<AesBackend backend = default_aes_backend, typename Policy, AesExecutionPolicy ExecutionPolicy>
+  void decrypt_ctr_parallel(Byte *data, std::size_t size, const AesContext<Policy> &context, const Nonce &nonce,
+                            ExecutionPolicy &&policy, std::size_t offset = 0,
+                            std::size_t threshold = parallel_threshold) {
+    const auto executor = [&](std::size_t nb_tasks, auto &&task) {
+      std::vector<std::size_t> tasks(nb_tasks);
+      std::iota(tasks.begin(), tasks.end(), std::size_t{0});
+      std::for_each(policy, tasks.begin(), tasks.end(), task);
+    };
+    decrypt_ctr_parallel<backend>(data, size, context, nonce, executor, offset, threshold);
+  }
+
+  /// Decrypt in-place a large buffer with a context using CTR (Counter) mode, on all the hardware threads.
+  /// \tparam backend Implementation of the cipher.
+  /// \param data bytes to be decrypted with AES. The number of bytes does not need to be a multiple of 128.
+  /// \param size Number of bytes to decrypt.
+  /// \param context AES context (expanded key), shared by all the threads.
+  /// \param nonce The random nonce to initialize the stream.
+  /// \param offset Position of the first byte in the stream (0 by default).
+  template<AesBackend backend = default_aes_backend, typename Policy>
+  void decrypt_ctr_parallel(Byte *data, std::size_t size, const AesContext<Policy> &context, const Nonce &nonce,
+                            std::size_t offset = 0) {
+    decrypt_ctr_parallel<backend>(data, size, context, nonce, ThreadExecutor{}, offset);
+  }
+}
+
+#endif
@@ -0,0 +1,121 @@
+// ADVobfuscator - Seekable reader of data encrypted with AES-CTR
+//
+// Copyright (c) 2025, Sebastien Andrivet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+// following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+// disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+// following disclaimer in the documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+// products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+// USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Get latest version on https://github.com/andrivet/ADVobfuscator
+
+#ifndef ADVOBFUSCATOR_AES_READER_H
+#define ADVOBFUSCATOR_AES_READER_H
+
+#include <cstddef>
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+#include "aes.h"
+#include "aes_string.h"
+
+namespace andrivet::advobfuscator {
+
+  /// Reader of data encrypted with AES-CTR, with random access.
+  /// \tparam Policy Size of the key and number of rounds.
+  /// \tparam backend Implementation of the cipher.
+  /// \remark Only the bytes read are decrypted, into the buffer of the caller: the counter of the first block
+  /// is computed directly from the position. The plain data is never stored by the reader.
+  template<typename Policy = DefaultAesPolicy, AesBackend backend = default_aes_backend>
+  class AesReader {
+  public:
+    /// Construct a reader of encrypted data.
+    /// \param encrypted The encrypted data. It is not copied and has to outlive the reader.
+    /// \param key AES key.
+    /// \param nonce The nonce of the stream.
+    /// \remark The key is expanded once, when the reader is constructed.
+    AesReader(std::span<const Byte> encrypted, const typename Policy::Key &key, const Nonce &nonce)
+    : data_{encrypted}, context_{key}, nonce_{nonce} {}
+
+    /// Construct a reader of the characters (without the terminal null byte) of an encrypted string.
+    /// \param str The encrypted string. It is not copied and has to outlive the reader.
+    template<std::size_t N, Conversion C>
+    explicit AesReader(const AesString<N, Policy, C> &str)
+    : data_{str.data_.data(), N - 1}, context_{str.context()}, nonce_{str.nonce_}, encrypted_{str.encrypted_} {}
+
+    // The reader holds the expanded key: it is not copied
+    AesReader(const AesReader &) = delete;
+    AesReader &operator=(const AesReader &) = delete;
+
+    /// Get the size of the data.
+    [[nodiscard]] std::size_t size() const noexcept { return data_.size(); }
+
+    /// Get the current position.
+    [[nodiscard]] std::size_t tell() const noexcept { return position_; }
+
+    /// Move the current position.
+    /// \param offset The new position. It can be the end of the data but not beyond.
+    void seek(std::size_t offset) {
+      if(offset > data_.size()) throw std::out_of_range("Position beyond the end of the encrypted data");
+      position_ = offset;
+    }
+
+    /// Read and decrypt bytes at the current position, then move the position after them.
+    /// \param out Buffer receiving the decrypted bytes.
+    /// \return The number of bytes read. It is less than the size of the buffer at the end of the data.
+    std::size_t read(std::span<Byte> out) noexcept {
+      const auto size = read_at(position_, out);
+      position_ += size;
+      return size;
+    }
+
+    /// Read and decrypt characters at the current position, then move the position after them.
+    /// \param out Buffer receiving the decrypted characters.
+    /// \return The number of characters read. It is less than the size of the buffer at the end of the data.
+    std::size_t read(std::span<char> out) noexcept {
+      return read(std::span<Byte>{reinterpret_cast<Byte *>(out.data()), out.size()});
+    }
+
+    /// Read and decrypt bytes at a given position. The current position is not modified.
+    /// \param offset Position of the first byte to read.
+    /// \param out Buffer receiving the decrypted bytes.
+    /// \return The number of bytes read. It is less than the size of the buffer at the end of the data.
+    std::size_t read_at(std::size_t offset, std::span<Byte> out) const noexcept {
+      if(offset >= data_.size()) return 0;
+      const auto size = std::min(out.size(), data_.size() - offset);
+      std::copy_n(data_.begin() + offset, size, out.begin());
+      if(encrypted_) decrypt_ctr<backend>(out.data(), size, context_, nonce_, offset);
+      return size;
+    }
+
+  private:
+    /// The encrypted data.
+    std::span<const Byte> data_;
+    /// The expanded key.
+    AesContext<Policy> context_;
+    /// The nonce of the stream.
+    Nonce nonce_;
+    /// Is the data encrypted (or was a string already decrypted in-place)?
+    bool encrypted_ = true;
+    /// The current position.
+    std::size_t position_ = 0;
+  };
+}
+
+#endif
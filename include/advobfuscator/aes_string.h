@@ -29,27 +29,45 @@
 #define ADVOBFUSCATOR_AES_STRING_H
 
 #include <cstddef>
+#include <cstdint>
 #include <algorithm>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <type_traits>
 #include "aes.h"
 #include "call.h"
+#include "fixed_string.h"
+#include "obf.h"
+#include "output.h"
+#include "view.h"
 
 namespace andrivet::advobfuscator {
 
   /// A compile-time string encrypted with AES-CTR.
-  template<std::size_t N>
+  /// \tparam N Number of characters (including the null terminal byte).
+  /// \tparam Policy Size of the key and number of rounds (AES-128 by default).
+  /// \tparam C Conversion to a pointer to characters, once the string is decrypted.
+  template<std::size_t N, typename Policy = DefaultAesPolicy, Conversion C = Conversion::OBFUSCATED>
   struct AesString {
     /// Construct a compile-time string encrypted with AES-CTR.
     /// \param str Array of characters to be encrypted at compile-time.
-    /// \remark A key and a nonce are generated on the fly.
+    /// \remark A key and a nonce are generated on the fly. Only the expanded key is stored, obfuscated.
     consteval AesString(const char (&str)[N]) noexcept
-    : key_{generate_random_block<16>(generate_sum(str, 0))},
-      nonce_{generate_random_block<8>(generate_sum(str, 16))} {
+    : nonce_{generate_random_block<8>(generate_sum(str, 16))},
+      ekey_algos_{generate_sum(str, 32)} {
+      const auto key = generate_random_block<Policy::key_bits / 8>(generate_sum(str, 0));
+      // Compile-time key schedule
+      const auto ekey = details::key_expansion<Policy>(key, details::compile_time::sub_word);
       // Compile-time copy of the data
       std::copy(str, str + N, data_.begin());
       // Compile-time encryption
-      auto encrypted = encrypt_ctr(data_, key_, nonce_);
+      auto encrypted = details::compile_time::encrypt_ctr(data_, ekey, nonce_);
       // Compile-time copy of the encrypted data
       std::copy(encrypted.begin(), encrypted.end(), data_.begin());
+      // Obfuscation of the expanded key
+      ekey_ = details::compile_time::obfuscate(ekey, ekey_algos_);
     }
 
     /// Destruct the string by first erasing its content.
@@ -59,27 +77,106 @@ namespace andrivet::advobfuscator {
     /// Implicit conversion to a pointer to (const) characters, like a regular string.
     operator const char *() noexcept {
       constexpr auto random = call::generate_random(__LINE__);
-      const ObfuscatedMethodCall call{random, &AesString::decrypt_inplace};
-      call(random, this);
+      obfuscated_conversion<C, random, &AesString::decrypt_inplace>(this, !encrypted_);
       return reinterpret_cast<const char *>(data_.data());
     }
 
     /// Decrypt the encrypted string.
     [[nodiscard]] constexpr std::string decrypt() const {
-      std::array<std::uint8_t, N> buffer;
-      std::copy(data_.begin(), data_.end(), buffer.begin());
-      if(encrypted_) decrypt_ctr(buffer.data(), N, key_, nonce_);
       std::string str;
-      str.resize(N - 1);
-      std::copy(buffer.begin(), buffer.end() - 1, str.begin());
+      decrypt_to(str);
+      return str;
+    }
+
+    /// Decrypt the encrypted string without any heap allocation.
+    /// \return The decrypted string, stored in place.
+    [[nodiscard]] FixedString<N> decrypt_fixed() const noexcept {
+      FixedString<N> str;
+      str.size_ = decrypt_range(N - 1, str.data_.data());
       return str;
     }
 
+    /// Decrypt the encrypted string into a buffer.
+    /// \param out The buffer. If there is enough room, the string is terminated by a null byte.
+    /// \return The number of characters decrypted (without the null byte).
+    std::size_t decrypt_to(std::span<char> out) const noexcept {
+      const auto size = decrypt_range(std::min(out.size(), N - 1), out.data());
+      if(size < out.size()) out[size] = '\0';
+      return size;
+    }
+
+    /// Decrypt the encrypted string into a string of characters, reusing its memory if possible.
+    /// \param str The string receiving the decrypted characters.
+    void decrypt_to(std::string &str) const {
+#if defined(__cpp_lib_string_resize_and_overwrite)
+      str.resize_and_overwrite(N - 1, [this](char *out, std::size_t size) { return decrypt_range(size, out); });
+#else
+      str.resize(N - 1);
+      decrypt_range(N - 1, str.data());
+#endif
+    }
+
+    /// Create the AES context of the string, from the expanded key computed at compile-time.
+    /// \return The AES context.
+    /// \remark The expanded key is only deobfuscated: there is no key schedule at runtime.
+    [[nodiscard]] AesContext<Policy> context() const noexcept { return AesContext<Policy>{ekey_, ekey_algos_}; }
+
     /// Get the raw (encrypted) content.
     [[nodiscard]] const char *raw() const noexcept { return data_.data(); }
 
     /// Get the actual length of the string.
-    [[nodiscard]] constexpr std::size_t size() noexcept { return N - 1; }
+    [[nodiscard]] constexpr std::size_t size() const noexcept { return N - 1; }
+
+    /// Decrypt the encrypted string by small chunks and send them to a sink.
+    /// \param sink Callable object receiving each chunk of decrypted characters as a std::string_view.
+    /// \param size Maximal number of characters to decrypt (the whole string by default).
+    /// \remark Only a small buffer on the stack is used and it is erased after use.
+    template<typename Sink>
+    void decrypt_chunks(Sink &&sink, std::size_t size = N - 1) const {
+      const auto context = this->context();
+      std::array<char, details::OUTPUT_CHUNK_SIZE> chunk;
+      size = std::min(size, N - 1);
+      for(std::size_t pos = 0; pos < size; pos += chunk.size()) {
+        const auto nb_chars = std::min(size - pos, chunk.size());
+        std::copy_n(data_.begin() + pos, nb_chars, chunk.begin());
+        if(encrypted_) decrypt_ctr(reinterpret_cast<Byte *>(chunk.data()), nb_chars, context, nonce_, pos);
+        sink(std::string_view{chunk.data(), nb_chars});
+      }
+      std::fill(chunk.begin(), chunk.end(), 0);
+    }
+
+    /// Decrypter of the characters of a string, one at a time.
+    /// \remark The key stream of the current block (16 characters) is cached. It is erased when the block changes
+    /// and when the cursor is destructed.
+    struct Cursor {
+      /// Destruct the cursor by first erasing the cached key stream.
+      constexpr ~Cursor() noexcept { details::erase(key_stream); }
+
+      /// Decrypt a character.
+      /// \param pos Position of the character in the string.
+      char operator()(std::size_t pos) const noexcept {
+        if(!string->encrypted_) return static_cast<char>(string->data_[pos]);
+        if(pos / 16 != block) {
+          block = pos / 16;
+          details::erase(key_stream);
+          key_stream = encrypt(details::counter_block(string->nonce_, block), string->context());
+        }
+        return static_cast<char>(string->data_[pos] ^ key_stream[pos % 16]);
+      }
+
+      /// The encrypted string.
+      const AesString *string = nullptr;
+      /// Index of the block of the cached key stream.
+      mutable std::size_t block = SIZE_MAX;
+      /// Cached key stream.
+      mutable Block key_stream{};
+    };
+
+    /// Get a view of the characters (without the terminal null byte), decrypted when they are accessed.
+    /// \remark The view refers to this string.
+    [[nodiscard]] constexpr DecodedView<Cursor> view() const & noexcept { return {Cursor{this}, N - 1}; }
+    /// A view of a temporary string would dangle.
+    void view() const && = delete;
 
     /// Encrypted or decrypted data.
     std::array<Byte, N> data_{};
@@ -87,29 +184,120 @@ namespace andrivet::advobfuscator {
     bool encrypted_ = true;
     /// The nonce used to chain blocks (CTR).
     Nonce nonce_{};
-    /// The key used to encrypt the data.
-    Key key_{};
+    /// The expanded key used to encrypt the data (obfuscated).
+    typename Policy::EKey ekey_{};
+    /// Set of algorithms used for the obfuscation of the expanded key.
+    Obfuscations ekey_algos_;
 
   private:
+    /// Decrypt the beginning of the string.
+    /// \param size Number of characters to decrypt. It has to be less than N.
+    /// \param out Buffer receiving the decrypted characters.
+    /// \return The number of characters decrypted.
+    std::size_t decrypt_range(std::size_t size, char *out) const noexcept {
+      std::copy_n(data_.begin(), size, out);
+      if(encrypted_) decrypt_ctr(reinterpret_cast<Byte *>(out), size, context(), nonce_);
+      return size;
+    }
+
     /// Erase the information stored by the string (data, key and nonce)
     constexpr void erase() noexcept {
       if (encrypted_) return;
       std::fill(data_.begin(), data_.end(), 0);
-      std::fill(key_.begin(), key_.end(), 0);
+      std::fill(ekey_.begin(), ekey_.end(), details::Word{});
       std::fill(nonce_.begin(), nonce_.end(), 0);
     }
 
     /// Run-time decryption
     void decrypt_inplace() noexcept {
       if(!encrypted_) return;
-      decrypt_ctr(reinterpret_cast<Byte*>(data_.data()), N, key_, nonce_);
+      decrypt_ctr(reinterpret_cast<Byte*>(data_.data()), N, context(), nonce_);
       encrypted_ = false;
     }
   };
 
+  /// Write an encrypted string to an output stream, without decrypting it in-place.
+  /// \remark The string is decrypted by small chunks. The width, fill and adjustment of the stream are honored.
+  template<std::size_t N, typename Policy, Conversion C>
+  std::ostream &operator<<(std::ostream &os, const AesString<N, Policy, C> &str) {
+    return details::write_chunks(os, str.size(), [&](auto &&sink, std::size_t size) { str.decrypt_chunks(sink, size); });
+  }
+
+  namespace details {
+    /// Is a type an AesString?
+    template<typename T>
+    struct IsAesString : std::false_type {};
+    template<std::size_t N, typename Policy, Conversion C>
+    struct IsAesString<AesString<N, Policy, C>> : std::true_type { using policy = Policy; };
+
+    /// Create the stream of a string, to decrypt it in a batch.
+    /// \param str The encrypted string. If it is already decrypted, the stream is empty.
+    /// \param context The context of the string.
+    template<std::size_t N, typename Policy, Conversion C>
+    CtrStream<Policy> batch_stream(AesString<N, Policy, C> &str, const AesContext<Policy> &context) noexcept {
+      return {reinterpret_cast<Byte *>(str.data_.data()), str.encrypted_ ? N : 0, &context, &str.nonce_};
+    }
+  }
+
+  /// Decrypt in-place several strings together.
+  /// \param strings The strings to decrypt. They can have different sizes but they share the same policy.
+  /// \remark The counter blocks of the strings are interleaved, so short strings keep the cipher pipeline full.
+  template<typename Policy, std::size_t... N, Conversion... C>
+  void decrypt_batch(AesString<N, Policy, C> &...strings) noexcept {
+    if constexpr(sizeof...(N) > 0) {
+      const AesContext<Policy> contexts[] = {strings.context()...};
+      CtrStream<Policy> streams[sizeof...(N)];
+      std::size_t i = 0;
+      ((streams[i] = details::batch_stream(strings, contexts[i]), ++i), ...);
+      decrypt_ctr_batch(streams, sizeof...(N));
+      ((strings.encrypted_ = false), ...);
+    }
+  }
+
+  /// Decrypt in-place a range of strings together.
+  /// \param strings The strings to decrypt.
+  /// \remark The strings are decrypted by groups and the counter blocks of a group are interleaved.
+  template<std::ranges::forward_range R>
+    requires details::IsAesString<std::remove_cvref_t<std::ranges::range_reference_t<R>>>::value
+  void decrypt_batch(R &&strings) noexcept {
+    using Policy = typename details::IsAesString<std::remove_cvref_t<std::ranges::range_reference_t<R>>>::policy;
+    static constexpr std::size_t GROUP = 8;
+
+    auto it = std::ranges::begin(strings);
+    const auto last = std::ranges::end(strings);
+    while(it != last) {
+      std::optional<AesContext<Policy>> contexts[GROUP];
+      CtrStream<Policy> streams[GROUP];
+      std::size_t count = 0;
+      const auto first = it;
+      for(; it != last && count < GROUP; ++it, ++count) {
+        contexts[count].emplace(it->ekey_, it->ekey_algos_);
+        streams[count] = details::batch_stream(*it, *contexts[count]);
+      }
+      decrypt_ctr_batch(streams, count);
+      for(auto decrypted = first; decrypted != it; ++decrypted) decrypted->encrypted_ = false;
+    }
+  }
+
   /// User-defined literal "_aes"
   template<AesString str>
   consteval auto operator""_aes() { return str; }
+
+  /// User-defined literal "_aes192" (AES-192)
+  template<details::Literal str>
+  consteval auto operator""_aes192() { return AesString<sizeof(str.chars), Aes192>{str.chars}; }
+
+  /// User-defined literal "_aes256" (AES-256)
+  template<details::Literal str>
+  consteval auto operator""_aes256() { return AesString<sizeof(str.chars), Aes256>{str.chars}; }
+
+  /// User-defined literal "_aes_light" (AES-128 with only 4 rounds, obfuscation grade for latency-critical strings)
+  template<details::Literal str>
+  consteval auto operator""_aes_light() { return AesString<sizeof(str.chars), AesLight>{str.chars}; }
+
+  /// User-defined literal "_aes_fast" (AES-128, conversions of the decrypted string skip the obfuscated call)
+  template<details::Literal str>
+  consteval auto operator""_aes_fast() { return AesString<sizeof(str.chars), Aes128, Conversion::FAST>{str.chars}; }
 }
 
 #endif
@@ -0,0 +1,166 @@
+// ADVobfuscator - Tables of compile-time strings encrypted with AES-CTR in a single pool
+//
+// Copyright (c) 2025, Sebastien Andrivet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+// following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+// disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+// following disclaimer in the documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+// products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+// USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Get latest version on https://github.com/andrivet/ADVobfuscator
+
+#ifndef ADVOBFUSCATOR_AES_STRING_TABLE_H
+#define ADVOBFUSCATOR_AES_STRING_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "aes.h"
+#include "obf.h"
+#include "random.h"
+
+namespace andrivet::advobfuscator {
+
+  /// A table of compile-time strings, encrypted with AES-CTR as a single stream (pool).
+  /// \tparam Policy Size of the key and number of rounds.
+  /// \tparam N Number of characters of each string (including the null terminal byte).
+  /// \remark There is one key and one nonce for the whole table. Each entry starts at its own position in the
+  /// stream, so it is decrypted alone from this position, and one key schedule can decrypt any number of entries.
+  template<typename Policy, std::size_t... N>
+  struct AesStringTable {
+    /// Number of entries.
+    static constexpr std::size_t count = sizeof...(N);
+    /// Size of the pool (the strings with their null terminal bytes).
+    static constexpr std::size_t pool_size = (N + ... + 0);
+
+    /// Construct a table of compile-time strings encrypted with AES-CTR.
+    /// \param str Arrays of characters to be encrypted at compile-time.
+    /// \remark A key and a nonce are generated on the fly. Only the expanded key is stored, obfuscated.
+    consteval explicit AesStringTable(const char (&...str)[N]) noexcept
+    : ekey_algos_{(generate_sum(str, 32) + ... + 0)} {
+      // Compile-time copy of the strings and of their positions
+      std::size_t offset = 0, index = 0;
+      ((offsets_[index++] = offset, std::copy(str, str + N, pool_.begin() + offset), offset += N), ...);
+      offsets_[count] = offset;
+
+      nonce_ = generate_random_block<8>(generate_sum(pool_, 16));
+      const auto key = generate_random_block<Policy::key_bits / 8>(generate_sum(pool_, 0));
+      // Compile-time key schedule
+      const auto ekey = details::key_expansion<Policy>(key, details::compile_time::sub_word);
+      // Compile-time encryption of the whole pool
+      pool_ = details::compile_time::encrypt_ctr(pool_, ekey, nonce_);
+      // Obfuscation of the expanded key
+      ekey_ = details::compile_time::obfuscate(ekey, ekey_algos_);
+    }
+
+    /// Get the number of entries.
+    [[nodiscard]] static constexpr std::size_t size() noexcept { return count; }
+
+    /// Get the length of an entry (without the null terminal byte).
+    /// \param index Index of the entry.
+    [[nodiscard]] constexpr std::size_t length(std::size_t index) const {
+      check(index);
+      return offsets_[index + 1] - offsets_[index] - 1;
+    }
+
+    /// Create a context to decrypt several entries with a single key schedule.
+    /// \return The AES context (expanded key) of the table.
+    /// \remark The expanded key is only deobfuscated: there is no key schedule at runtime.
+    [[nodiscard]] AesContext<Policy> context() const noexcept { return AesContext<Policy>{ekey_, ekey_algos_}; }
+
+    /// Decrypt an entry into a buffer.
+    /// \param index Index of the entry.
+    /// \param out The buffer. If there is enough room, the string is terminated by a null byte.
+    /// \param context The context of the table.
+    /// \return The number of characters decrypted (without the null byte).
+    std::size_t decrypt_to(std::size_t index, std::span<char> out, const AesContext<Policy> &context) const {
+      const auto size = std::min(length(index), out.size());
+      std::copy_n(pool_.begin() + offsets_[index], size, out.begin());
+      decrypt_ctr(reinterpret_cast<Byte *>(out.data()), size, context, nonce_, offsets_[index]);
+      if(size < out.size()) out[size] = '\0';
+      return size;
+    }
+
+    /// Decrypt an entry.
+    /// \param index Index of the entry.
+    /// \param context The context of the table.
+    /// \return The decrypted string.
+    [[nodiscard]] std::string decrypt(std::size_t index, const AesContext<Policy> &context) const {
+      std::string str(length(index), '\0');
+      decrypt_to(index, str, context);
+      return str;
+    }
+
+    /// Decrypt an entry.
+    /// \param index Index of the entry.
+    /// \return The decrypted string.
+    /// \remark To decrypt several entries, create a context once instead.
+    [[nodiscard]] std::string decrypt(std::size_t index) const { return decrypt(index, context()); }
+
+    /// Decrypt all the entries, in one pass over the pool.
+    /// \return The decrypted strings.
+    [[nodiscard]] std::vector<std::string> decrypt_all() const {
+      std::array<Byte, pool_size> pool = pool_;
+      decrypt_ctr(pool.data(), pool.size(), context(), nonce_);
+      std::vector<std::string> strings;
+      strings.reserve(count);
+      for(std::size_t i = 0; i < count; ++i)
+        strings.emplace_back(reinterpret_cast<const char *>(pool.data()) + offsets_[i], length(i));
+      details::erase(pool);
+      return strings;
+    }
+
+    /// Encrypted strings, one after the other.
+    std::array<Byte, pool_size> pool_{};
+    /// Position of each string in the pool, followed by the size of the pool.
+    std::array<std::size_t, count + 1> offsets_{};
+    /// The nonce of the stream.
+    Nonce nonce_{};
+    /// The expanded key used to encrypt the pool (obfuscated).
+    typename Policy::EKey ekey_{};
+    /// Set of algorithms used for the obfuscation of the expanded key.
+    Obfuscations ekey_algos_;
+
+  private:
+    /// Check the index of an entry.
+    /// \param index Index of an entry.
+    static constexpr void check(std::size_t index) {
+      if(index >= count) throw std::out_of_range("Invalid index of string in the table");
+    }
+  };
+
+  /// Deduction guide: the default policy (AES-128).
+  template<std::size_t... N>
+  AesStringTable(const char (&...str)[N]) -> AesStringTable<DefaultAesPolicy, N...>;
+
+  /// Construct a table of compile-time strings encrypted with AES-CTR, with a given policy.
+  /// \tparam Policy Size of the key and number of rounds.
+  /// \param str Arrays of characters to be encrypted at compile-time.
+  /// \return The table.
+  template<typename Policy, std::size_t... N>
+  consteval AesStringTable<Policy, N...> make_aes_string_table(const char (&...str)[N]) {
+    return AesStringTable<Policy, N...>{str...};
+  }
+}
+
+#endif
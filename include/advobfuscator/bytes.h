@@ -31,9 +31,11 @@
 #include <cstddef>
 #include <cstdint>
 #include <stdexcept>
+#include <algorithm>
 #include <array>
 #include <vector>
 #include "obf.h"
+#include "view.h"
 
 namespace andrivet::advobfuscator {
 
@@ -51,6 +53,14 @@ namespace andrivet::advobfuscator {
       encode();
     }
 
+    /// Construct a compile-time block of bytes from bytes computed at compile-time.
+    /// \param bytes Array of bytes to be encrypted at compile-time.
+    /// \remark The size of the block (N) is still expressed as the length of the corresponding string (3 per byte).
+    consteval explicit ObfuscatedBytes(const std::array<std::uint8_t, N / 3> &bytes)
+    : data_{bytes}, algos_{generate_sum(bytes)} {
+      encode();
+    }
+
     /// Destruct the block by first erasing its content.
     /// \remark The erasing may be omitted by the compiler.
     constexpr ~ObfuscatedBytes() noexcept { erase(); }
@@ -73,6 +83,26 @@ namespace andrivet::advobfuscator {
       return b;
     }
 
+    /// Decoder of the bytes of a block, one at a time.
+    struct Cursor {
+      /// Decode a byte.
+      /// \param pos Position of the byte in the block.
+      constexpr std::uint8_t operator()(std::size_t pos) const noexcept {
+        std::uint8_t b{};
+        block->decode_range(pos, 1, &b);
+        return b;
+      }
+
+      /// The obfuscated block of bytes.
+      const ObfuscatedBytes *block = nullptr;
+    };
+
+    /// Get a view of the bytes, decoded when they are accessed.
+    /// \remark The view refers to this block of bytes.
+    [[nodiscard]] constexpr DecodedView<Cursor> view() const & noexcept { return {Cursor{this}, N / 3}; }
+    /// A view of a temporary block would dangle.
+    void view() const && = delete;
+
     /// Decode (deobfuscate) the block of bytes.
     /// \return The decoded bytes.
     [[nodiscard]] constexpr std::array<std::uint8_t, N / 3> decode() const noexcept {
@@ -82,6 +112,34 @@ namespace andrivet::advobfuscator {
       return buffer;
     }
 
+    /// Decode a part of the block of bytes.
+    /// \param pos Position of the first byte to decode.
+    /// \param len Number of bytes to decode.
+    /// \param out Buffer receiving the decoded bytes. It has to be large enough for len bytes.
+    /// \return The number of bytes decoded. It is less than len if the end of the block is reached.
+    constexpr std::size_t decode(std::size_t pos, std::size_t len, std::uint8_t *out) const noexcept {
+      return decode_range(pos, std::min(len, N / 3 - std::min(pos, N / 3)), out);
+    }
+
+    /// Decode a part of the block of bytes until a null byte is found.
+    /// \param pos Position of the first byte to decode.
+    /// \param len Maximal number of bytes to decode, including the null byte.
+    /// \param out Buffer receiving the decoded bytes. It has to be large enough for len bytes.
+    /// \return The number of bytes decoded before the null byte, or the number of bytes decoded if no null byte
+    /// was found.
+    /// \remark The decoding is done by chunks and stops after the chunk containing the null byte.
+    constexpr std::size_t decode_prefix(std::size_t pos, std::size_t len, std::uint8_t *out) const noexcept {
+      len = std::min(len, N / 3 - std::min(pos, N / 3));
+      std::size_t done = 0;
+      while(done < len) {
+        const auto size = decode_range(pos + done, std::min(len - done, details::DECODE_CHUNK_SIZE), out + done);
+        const auto nul = std::find(out + done, out + done + size, 0);
+        if(nul != out + done + size) return static_cast<std::size_t>(nul - out);
+        done += size;
+      }
+      return done;
+    }
+
     /// Obfuscated or decoded data.
     std::array<std::uint8_t, N / 3> data_{};
     /// Set of algorithms used for the obfuscation.
@@ -90,6 +148,16 @@ namespace andrivet::advobfuscator {
     bool obfuscated_ = true;
 
   private:
+    /// Decode a range of bytes.
+    /// \param pos Position of the first byte to decode. It has to be in the block.
+    /// \param len Number of bytes to decode. The range has to be in the block.
+    /// \param out Buffer receiving the decoded bytes.
+    constexpr std::size_t decode_range(std::size_t pos, std::size_t len, std::uint8_t *out) const noexcept {
+      std::copy_n(data_.begin() + pos, len, out);
+      if(obfuscated_) algos_.decode(pos, out, out + len);
+      return len;
+    }
+
     /// Convert an hexadecimal digit to its value.
     static consteval std::uint8_t hex_char_value(char c) {
       if('0' <= c && c <= '9') return c - '0';
@@ -33,7 +33,13 @@
 
 namespace andrivet::advobfuscator {
 
-  template<typename F>
+  /// Conversion of a string to a pointer to characters, once it is decoded.
+  enum class Conversion {
+    OBFUSCATED, ///< Each conversion runs the obfuscated call (default), even if the string is already decoded
+    FAST        ///< Once the string is decoded, the conversions return it directly (for hot paths such as logging)
+  };
+
+  template<typename F, std::size_t Bits = NB_BITS>
   struct ObfuscatedCall {
     consteval ObfuscatedCall(std::uint32_t recognize, F fn)
     : fsm_{recognize, fn} {
@@ -50,10 +56,10 @@ namespace andrivet::advobfuscator {
         return std::invoke(fn, args...);
     }
 
-    Fsm<F> fsm_;
+    Fsm<F, Bits> fsm_;
   };
 
-  template<typename F>
+  template<typename F, std::size_t Bits = NB_BITS>
   struct ObfuscatedMethodCall {
     consteval ObfuscatedMethodCall(std::uint32_t recognize, F fn)
     : fsm_{recognize, fn} {
@@ -70,9 +76,39 @@ namespace andrivet::advobfuscator {
         return std::invoke(fn, args...);
     }
 
-    Fsm<F> fsm_;
+    Fsm<F, Bits> fsm_;
   };
 
+  /// Obfuscated call of a function, stored statically.
+  /// \tparam recognize The number to be recognized.
+  /// \tparam fn The function to call.
+  /// \remark The table of the FSM is sized to the number of bits of the number, and it is not rebuilt on the stack
+  /// for each call. All the uses with the same number and function share the same object.
+  /// It is initialized at compile time but it is not a constant: the compiler does not know the function called
+  /// and cannot replace the call through the FSM by a direct call.
+  template<std::uint32_t recognize, auto fn>
+  inline constinit ObfuscatedCall<decltype(fn), details::num_bits(recognize)> obfuscated_call{recognize, fn};
+
+  /// Obfuscated call of a member function, stored statically.
+  /// \tparam recognize The number to be recognized.
+  /// \tparam fn The member function to call.
+  /// \remark All the uses with the same number and member function share the same object (not a constant).
+  template<std::uint32_t recognize, auto fn>
+  inline constinit ObfuscatedMethodCall<decltype(fn), details::num_bits(recognize)> obfuscated_method_call{recognize, fn};
+
+  /// Decode an object with an obfuscated call of one of its member functions, when it is converted.
+  /// \tparam C Conversion: with FAST, the obfuscated call is skipped once the object is decoded.
+  /// \tparam recognize The number to be recognized.
+  /// \tparam fn The member function decoding the object.
+  /// \param o The object to decode.
+  /// \param decoded Is the object already decoded?
+  template<Conversion C, std::uint32_t recognize, auto fn, typename O>
+  void obfuscated_conversion(O *o, bool decoded) noexcept {
+    if constexpr(C == Conversion::FAST) {
+      if(decoded) return;
+    }
+    obfuscated_method_call<recognize, fn>(recognize, o);
+  }
 }
 
 #endif
@@ -0,0 +1,413 @@
+// ADVobfuscator - ChaCha20 stream cipher (RFC 8439)
+//
+// Copyright (c) 2025, Sebastien Andrivet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+// following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+// disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+// following disclaimer in the documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+// products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+// USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Get latest version on https://github.com/andrivet/ADVobfuscator
+
+#ifndef ADVOBFUSCATOR_CHACHA_H
+#define ADVOBFUSCATOR_CHACHA_H
+
+// References:
+// * https://www.rfc-editor.org/rfc/rfc8439
+// * https://cr.yp.to/chacha/chacha-20080128.pdf
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include "cpu.h"
+#include "obf.h"
+
+namespace andrivet::advobfuscator {
+  /// ChaCha20 key (256-bit)
+  using ChaChaKey = std::array<Byte, 32>;
+  /// ChaCha20 nonce (96-bit)
+  using ChaChaNonce = std::array<Byte, 12>;
+
+  /// Implementations of the ChaCha20 cipher
+  enum class ChaChaBackend {
+    PORTABLE, ///< One block at a time, in plain C++
+    SSE2,     ///< 4 blocks processed in parallel in SSE2 registers (x86-64), portable otherwise
+    AVX2      ///< 8 blocks processed in parallel in AVX2 registers when available, SSE2 otherwise
+  };
+
+  /// Implementation of the ChaCha20 cipher used by default
+  static constexpr ChaChaBackend default_chacha_backend{ChaChaBackend::AVX2};
+
+  // ------------------------------------------------------------------
+  // Portable
+  // ------------------------------------------------------------------
+
+  namespace details::chacha {
+    /// Size of a block of key stream
+    static constexpr std::size_t BLOCK_SIZE = 64;
+    /// State of the cipher: constants, key, counter and nonce.
+    using State = std::array<std::uint32_t, 16>;
+
+    /// Load a little-endian 32-bit word.
+    constexpr std::uint32_t load(const Byte *bytes) {
+      return std::uint32_t{bytes[0]} | std::uint32_t{bytes[1]} << 8 | std::uint32_t{bytes[2]} << 16 |
+             std::uint32_t{bytes[3]} << 24;
+    }
+
+    /// Initialize the state of the cipher.
+    /// \param key The key.
+    /// \param nonce The nonce.
+    /// \return The state, with a block counter of 0.
+    /// \remark Section 2.3
+    constexpr State initial_state(const ChaChaKey &key, const ChaChaNonce &nonce) {
+      // "expand 32-byte k"
+      State state{0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+      for(std::size_t i = 0; i < 8; ++i) state[4 + i] = load(key.data() + i * 4);
+      for(std::size_t i = 0; i < 3; ++i) state[13 + i] = load(nonce.data() + i * 4);
+      return state;
+    }
+
+    /// The quarter round on 4 words of the state.
+    /// \remark Section 2.1
+    constexpr void quarter_round(State &x, std::size_t a, std::size_t b, std::size_t c, std::size_t d) {
+      x[a] += x[b]; x[d] = std::rotl(x[d] ^ x[a], 16);
+      x[c] += x[d]; x[b] = std::rotl(x[b] ^ x[c], 12);
+      x[a] += x[b]; x[d] = std::rotl(x[d] ^ x[a], 8);
+      x[c] += x[d]; x[b] = std::rotl(x[b] ^ x[c], 7);
+    }
+
+    /// Compute a block of key stream.
+    /// \param state The state of the cipher.
+    /// \param counter The block counter.
+    /// \return The block of key stream, as little-endian words.
+    /// \remark Section 2.3
+    constexpr State block(const State &state, std::uint32_t counter) {
+      auto x = state;
+      x[12] = counter;
+      auto initial = x;
+      for(std::size_t i = 0; i < 10; ++i) {
+        // Column round, then diagonal round
+        quarter_round(x, 0, 4, 8, 12);
+        quarter_round(x, 1, 5, 9, 13);
+        quarter_round(x, 2, 6, 10, 14);
+        quarter_round(x, 3, 7, 11, 15);
+        quarter_round(x, 0, 5, 10, 15);
+        quarter_round(x, 1, 6, 11, 12);
+        quarter_round(x, 2, 7, 8, 13);
+        quarter_round(x, 3, 4, 9, 14);
+      }
+      for(std::size_t i = 0; i < 16; ++i) x[i] += initial[i];
+      erase(initial);
+      return x;
+    }
+
+    /// Combine data with the key stream, one block at a time.
+    /// \param data bytes to be encrypted or decrypted.
+    /// \param size Number of bytes.
+    /// \param state The state of the cipher.
+    /// \param offset Position of the first byte in the stream.
+    constexpr void xor_stream(Byte *data, std::size_t size, const State &state, std::size_t offset) {
+      auto counter = static_cast<std::uint32_t>(offset / BLOCK_SIZE);
+      auto skip = offset % BLOCK_SIZE;
+      while(size > 0) {
+        auto stream = block(state, counter++);
+        const auto nb_bytes = std::min(BLOCK_SIZE - skip, size);
+        for(std::size_t j = 0; j < nb_bytes; ++j)
+          data[j] ^= static_cast<Byte>(stream[(skip + j) / 4] >> 8 * ((skip + j) % 4));
+        erase(stream);
+        data += nb_bytes;
+        size -= nb_bytes;
+        skip = 0;
+      }
+    }
+  }
+
+  // ------------------------------------------------------------------
+  // SSE2 and AVX2 (x86-64)
+  // ------------------------------------------------------------------
+
+#if defined(ADVOBFUSCATOR_X86_64)
+
+  // Several blocks are computed in parallel: each vector holds the same word of the state of several blocks
+  // (one block per lane), so the quarter rounds are the same as for a single block. At the end, the words
+  // are transposed (4 x 4 words) to get the key stream of each block.
+
+  namespace details::chacha::sse2 {
+    using V = __m128i;
+    /// Number of blocks computed at once.
+    static constexpr std::size_t NB_BLOCKS = 4;
+
+    template<int C>
+    inline V rotl(V x) noexcept { return _mm_or_si128(_mm_slli_epi32(x, C), _mm_srli_epi32(x, 32 - C)); }
+
+    inline void quarter_round(V (&x)[16], std::size_t a, std::size_t b, std::size_t c, std::size_t d) noexcept {
+      x[a] = _mm_add_epi32(x[a], x[b]); x[d] = rotl<16>(_mm_xor_si128(x[d], x[a]));
+      x[c] = _mm_add_epi32(x[c], x[d]); x[b] = rotl<12>(_mm_xor_si128(x[b], x[c]));
+      x[a] = _mm_add_epi32(x[a], x[b]); x[d] = rotl<8>(_mm_xor_si128(x[d], x[a]));
+      x[c] = _mm_add_epi32(x[c], x[d]); x[b] = rotl<7>(_mm_xor_si128(x[b], x[c]));
+    }
+
+    /// Transpose 4 vectors of 4 words.
+    inline void transpose(V &a, V &b, V &c, V &d) noexcept {
+      const V t0 = _mm_unpacklo_epi32(a, b), t1 = _mm_unpacklo_epi32(c, d);
+      const V t2 = _mm_unpackhi_epi32(a, b), t3 = _mm_unpackhi_epi32(c, d);
+      a = _mm_unpacklo_epi64(t0, t1);
+      b = _mm_unpackhi_epi64(t0, t1);
+      c = _mm_unpacklo_epi64(t2, t3);
+      d = _mm_unpackhi_epi64(t2, t3);
+    }
+
+    /// Combine whole groups of blocks with the key stream.
+    /// \param data bytes to be encrypted or decrypted, starting at a block boundary.
+    /// \param size Number of bytes.
+    /// \param state The state of the cipher.
+    /// \param counter The counter of the first block.
+    /// \return The number of bytes combined (a multiple of 4 blocks).
+    inline std::size_t xor_blocks(Byte *data, std::size_t size, const State &state, std::uint32_t counter) noexcept {
+      V initial[16], x[16];
+      for(std::size_t i = 0; i < 16; ++i) initial[i] = _mm_set1_epi32(static_cast<int>(state[i]));
+      initial[12] = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(counter)), _mm_set_epi32(3, 2, 1, 0));
+      const V step = _mm_set1_epi32(static_cast<int>(NB_BLOCKS));
+
+      std::size_t done = 0;
+      for(; done + NB_BLOCKS * BLOCK_SIZE <= size; done += NB_BLOCKS * BLOCK_SIZE) {
+        std::copy_n(initial, 16, x);
+        for(std::size_t i = 0; i < 10; ++i) {
+          quarter_round(x, 0, 4, 8, 12);
+          quarter_round(x, 1, 5, 9, 13);
+          quarter_round(x, 2, 6, 10, 14);
+          quarter_round(x, 3, 7, 11, 15);
+          quarter_round(x, 0, 5, 10, 15);
+          quarter_round(x, 1, 6, 11, 12);
+          quarter_round(x, 2, 7, 8, 13);
+          quarter_round(x, 3, 4, 9, 14);
+        }
+        for(std::size_t i = 0; i < 16; ++i) x[i] = _mm_add_epi32(x[i], initial[i]);
+        // After the transposition of the words 4w to 4w + 3, the vector 4w + b holds them for the block b
+        for(std::size_t w = 0; w < 4; ++w) {
+          transpose(x[4 * w], x[4 * w + 1], x[4 * w + 2], x[4 * w + 3]);
+          for(std::size_t b = 0; b < NB_BLOCKS; ++b) {
+            auto *p = reinterpret_cast<V *>(data + done + b * BLOCK_SIZE + w * 16);
+            _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), x[4 * w + b]));
+          }
+        }
+        initial[12] = _mm_add_epi32(initial[12], step);
+      }
+      erase(initial);
+      erase(x);
+      return done;
+    }
+  }
+
+  namespace details::chacha::avx2 {
+    using V = __m256i;
+    /// Number of blocks computed at once.
+    static constexpr std::size_t NB_BLOCKS = 8;
+
+    template<int C>
+    ADVOBFUSCATOR_TARGET("avx2")
+    inline V rotl(V x) noexcept { return _mm256_or_si256(_mm256_slli_epi32(x, C), _mm256_srli_epi32(x, 32 - C)); }
+
+    ADVOBFUSCATOR_TARGET("avx2")
+    inline void quarter_round(V (&x)[16], std::size_t a, std::size_t b, std::size_t c, std::size_t d) noexcept {
+      x[a] = _mm256_add_epi32(x[a], x[b]); x[d] = rotl<16>(_mm256_xor_si256(x[d], x[a]));
+      x[c] = _mm256_add_epi32(x[c], x[d]); x[b] = rotl<12>(_mm256_xor_si256(x[b], x[c]));
+      x[a] = _mm256_add_epi32(x[a], x[b]); x[d] = rotl<8>(_mm256_xor_si256(x[d], x[a]));
+      x[c] = _mm256_add_epi32(x[c], x[d]); x[b] = rotl<7>(_mm256_xor_si256(x[b], x[c]));
+    }
+
+    /// Transpose 4 vectors of 4 words, in each half (128-bit lane) of the vectors.
+    ADVOBFUSCATOR_TARGET("avx2")
+    inline void transpose(V &a, V &b, V &c, V &d) noexcept {
+      const V t0 = _mm256_unpacklo_epi32(a, b), t1 = _mm256_unpacklo_epi32(c, d);
+      const V t2 = _mm256_unpackhi_epi32(a, b), t3 = _mm256_unpackhi_epi32(c, d);
+      a = _mm256_unpacklo_epi64(t0, t1);
+      b = _mm256_unpackhi_epi64(t0, t1);
+      c = _mm256_unpacklo_epi64(t2, t3);
+      d = _mm256_unpackhi_epi64(t2, t3);
+    }
+
+    /// Combine 16 bytes of data with the key stream.
+    ADVOBFUSCATOR_TARGET("avx2")
+    inline void combine(Byte *data, __m128i stream) noexcept {
+      auto *p = reinterpret_cast<__m128i *>(data);
+      _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), stream));
+    }
+
+    /// Combine whole groups of blocks with the key stream.
+    /// \param data bytes to be encrypted or decrypted, starting at a block boundary.
+    /// \param size Number of bytes.
+    /// \param state The state of the cipher.
+    /// \param counter The counter of the first block.
+    /// \return The number of bytes combined (a multiple of 8 blocks).
+    ADVOBFUSCATOR_TARGET("avx2")
+    inline std::size_t xor_blocks(Byte *data, std::size_t size, const State &state, std::uint32_t counter) noexcept {
+      V initial[16], x[16];
+      for(std::size_t i = 0; i < 16; ++i) initial[i] = _mm256_set1_epi32(static_cast<int>(state[i]));
+      initial[12] = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(counter)), _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+      const V step = _mm256_set1_epi32(static_cast<int>(NB_BLOCKS));
+
+      std::size_t done = 0;
+      for(; done + NB_BLOCKS * BLOCK_SIZE <= size; done += NB_BLOCKS * BLOCK_SIZE) {
+        std::copy_n(initial, 16, x);
+        for(std::size_t i = 0; i < 10; ++i) {
+          quarter_round(x, 0, 4, 8, 12);
+          quarter_round(x, 1, 5, 9, 13);
+          quarter_round(x, 2, 6, 10, 14);
+          quarter_round(x, 3, 7, 11, 15);
+          quarter_round(x, 0, 5, 10, 15);
+          quarter_round(x, 1, 6, 11, 12);
+          quarter_round(x, 2, 7, 8, 13);
+          quarter_round(x, 3, 4, 9, 14);
+        }
+        for(std::size_t i = 0; i < 16; ++i) x[i] = _mm256_add_epi32(x[i], initial[i]);
+        // After the transposition, the lower half of the vector 4w + b holds the words 4w to 4w + 3 of the block b,
+        // and its upper half the ones of the block b + 4
+        for(std::size_t w = 0; w < 4; ++w) {
+          transpose(x[4 * w], x[4 * w + 1], x[4 * w + 2], x[4 * w + 3]);
+          for(std::size_t b = 0; b < 4; ++b) {
+            combine(data + done + b * BLOCK_SIZE + w * 16, _mm256_castsi256_si128(x[4 * w + b]));
+            combine(data + done + (b + 4) * BLOCK_SIZE + w * 16, _mm256_extracti128_si256(x[4 * w + b], 1));
+          }
+        }
+        initial[12] = _mm256_add_epi32(initial[12], step);
+      }
+      erase(initial);
+      erase(x);
+      return done;
+    }
+  }
+
+#endif
+
+  // ------------------------------------------------------------------
+  // Context
+  // ------------------------------------------------------------------
+
+  /// ChaCha20 context: the state of the cipher without the nonce, erased when it is destructed.
+  class ChaChaContext {
+  public:
+    /// Construct a context from a key.
+    /// \param key ChaCha20 key.
+    constexpr explicit ChaChaContext(const ChaChaKey &key) noexcept
+    : state_{details::chacha::initial_state(key, ChaChaNonce{})} {}
+    /// Construct a context from an obfuscated key.
+    /// \param key The obfuscated key.
+    /// \param algos Set of algorithms used for the obfuscation of the key.
+    constexpr ChaChaContext(const ChaChaKey &key, const Obfuscations &algos) noexcept {
+      auto bytes = key;
+      algos.decode(0, bytes.begin(), bytes.end());
+      state_ = details::chacha::initial_state(bytes, ChaChaNonce{});
+      details::erase(bytes);
+    }
+    /// Destruct the context and erase the key.
+    constexpr ~ChaChaContext() noexcept { details::erase(state_); }
+
+    // The key is a secret: it is not copied
+    ChaChaContext(const ChaChaContext &) = delete;
+    ChaChaContext &operator=(const ChaChaContext &) = delete;
+
+    /// Get the state of the cipher, with a nonce.
+    /// \param nonce The nonce.
+    /// \return The state, with a block counter of 0.
+    [[nodiscard]] constexpr details::chacha::State state(const ChaChaNonce &nonce) const noexcept {
+      auto state = state_;
+      for(std::size_t i = 0; i < 3; ++i) state[13 + i] = details::chacha::load(nonce.data() + i * 4);
+      return state;
+    }
+
+  private:
+    details::chacha::State state_{};
+  };
+
+  // ------------------------------------------------------------------
+  // Public functions
+  // ------------------------------------------------------------------
+
+  /// Encrypt (at compile time) an array of bytes with ChaCha20.
+  /// \param data bytes to be encrypted.
+  /// \param key ChaCha20 key.
+  /// \param nonce The random nonce of the stream.
+  /// \return The encrypted bytes.
+  template<std::size_t N>
+  [[nodiscard]] consteval std::array<Byte, N> encrypt_chacha20(const std::array<Byte, N> &data, const ChaChaKey &key,
+                                                               const ChaChaNonce &nonce) {
+    auto encrypted = data;
+    details::chacha::xor_stream(encrypted.data(), N, details::chacha::initial_state(key, nonce), 0);
+    return encrypted;
+  }
+
+  /// Decrypt in-place bytes with a context using ChaCha20.
+  /// \tparam backend Implementation of the cipher.
+  /// \param data bytes to be decrypted.
+  /// \param size Number of bytes.
+  /// \param context ChaCha20 context (key).
+  /// \param nonce The nonce of the stream.
+  /// \param offset Position of the first byte in the stream (0 by default). The block counter starts at offset / 64.
+  template<ChaChaBackend backend = default_chacha_backend>
+  inline void decrypt_chacha20(Byte *data, std::size_t size, const ChaChaContext &context, const ChaChaNonce &nonce,
+                               std::size_t offset = 0) {
+    using namespace details::chacha;
+    auto state = context.state(nonce);
+
+    // A partial first block
+    if(const auto skip = offset % BLOCK_SIZE; skip != 0 && size > 0) {
+      const auto nb_bytes = std::min(BLOCK_SIZE - skip, size);
+      xor_stream(data, nb_bytes, state, offset);
+      data += nb_bytes;
+      size -= nb_bytes;
+      offset += nb_bytes;
+    }
+
+#if defined(ADVOBFUSCATOR_X86_64)
+    std::size_t done = 0;
+    const auto counter = static_cast<std::uint32_t>(offset / BLOCK_SIZE);
+    if constexpr(backend == ChaChaBackend::AVX2) {
+      if(cpu::has_avx2()) done = avx2::xor_blocks(data, size, state, counter);
+    }
+    if constexpr(backend != ChaChaBackend::PORTABLE) {
+      // The blocks left by AVX2 (or all of them without AVX2)
+      done += sse2::xor_blocks(data + done, size - done, state, counter + static_cast<std::uint32_t>(done / BLOCK_SIZE));
+    }
+    data += done;
+    size -= done;
+    offset += done;
+#endif
+
+    xor_stream(data, size, state, offset);
+    details::erase(state);
+  }
+
+  /// Decrypt in-place bytes with a key using ChaCha20.
+  /// \tparam backend Implementation of the cipher.
+  /// \param data bytes to be decrypted.
+  /// \param size Number of bytes.
+  /// \param key ChaCha20 key.
+  /// \param nonce The nonce of the stream.
+  /// \param offset Position of the first byte in the stream (0 by default).
+  template<ChaChaBackend backend = default_chacha_backend>
+  inline void decrypt_chacha20(Byte *data, std::size_t size, const ChaChaKey &key, const ChaChaNonce &nonce,
+                               std::size_t offset = 0) {
+    decrypt_chacha20<backend>(data, size, ChaChaContext{key}, nonce, offset);
+  }
+}
+
+#endif
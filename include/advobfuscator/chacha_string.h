@@ -0,0 +1,230 @@
+// ADVobfuscator - Compile-time strings encrypted with ChaCha20
+//
+// Copyright (c) 2025, Sebastien Andrivet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+// following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+// disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+// following disclaimer in the documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+// products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+// USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Get latest version on https://github.com/andrivet/ADVobfuscator
+
+#ifndef ADVOBFUSCATOR_CHACHA_STRING_H
+#define ADVOBFUSCATOR_CHACHA_STRING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <span>
+#include <string>
+#include "call.h"
+#include "chacha.h"
+#include "fixed_string.h"
+#include "obf.h"
+#include "output.h"
+#include "view.h"
+
+namespace andrivet::advobfuscator {
+
+  /// A compile-time string encrypted with ChaCha20.
+  /// \tparam N Number of characters (including the null terminal byte).
+  /// \tparam C Conversion to a pointer to characters, once the string is decrypted.
+  /// \remark Same interface as AesString. ChaCha20 only uses additions, rotations and xors (ARX): there is no
+  /// table lookup, and the key stream is computed in vector registers (SSE2, AVX2) without AES instructions.
+  template<std::size_t N, Conversion C = Conversion::OBFUSCATED>
+  struct ChaChaString {
+    /// Construct a compile-time string encrypted with ChaCha20.
+    /// \param str Array of characters to be encrypted at compile-time.
+    /// \remark A key and a nonce are generated on the fly. The key is stored obfuscated.
+    consteval ChaChaString(const char (&str)[N]) noexcept
+    : nonce_{generate_random_block<12>(generate_sum(str, 16))},
+      key_{generate_random_block<32>(generate_sum(str, 0))},
+      key_algos_{generate_sum(str, 32)} {
+      // Compile-time copy of the data
+      std::copy(str, str + N, data_.begin());
+      // Compile-time encryption
+      data_ = encrypt_chacha20(data_, key_, nonce_);
+      // Obfuscation of the key
+      key_algos_.encode(0, key_.begin(), key_.end());
+    }
+
+    /// Destruct the string by first erasing its content.
+    /// \remark The erasing may be omitted by the compiler.
+    constexpr ~ChaChaString() noexcept { erase(); }
+
+    /// Implicit conversion to a pointer to (const) characters, like a regular string.
+    operator const char *() noexcept {
+      constexpr auto random = call::generate_random(__LINE__);
+      obfuscated_conversion<C, random, &ChaChaString::decrypt_inplace>(this, !encrypted_);
+      return reinterpret_cast<const char *>(data_.data());
+    }
+
+    /// Decrypt the encrypted string.
+    [[nodiscard]] constexpr std::string decrypt() const {
+      std::string str;
+      decrypt_to(str);
+      return str;
+    }
+
+    /// Decrypt the encrypted string without any heap allocation.
+    /// \return The decrypted string, stored in place.
+    [[nodiscard]] FixedString<N> decrypt_fixed() const noexcept {
+      FixedString<N> str;
+      str.size_ = decrypt_range(N - 1, str.data_.data());
+      return str;
+    }
+
+    /// Decrypt the encrypted string into a buffer.
+    /// \param out The buffer. If there is enough room, the string is terminated by a null byte.
+    /// \return The number of characters decrypted (without the null byte).
+    std::size_t decrypt_to(std::span<char> out) const noexcept {
+      const auto size = decrypt_range(std::min(out.size(), N - 1), out.data());
+      if(size < out.size()) out[size] = '\0';
+      return size;
+    }
+
+    /// Decrypt the encrypted string into a string of characters, reusing its memory if possible.
+    /// \param str The string receiving the decrypted characters.
+    void decrypt_to(std::string &str) const {
+#if defined(__cpp_lib_string_resize_and_overwrite)
+      str.resize_and_overwrite(N - 1, [this](char *out, std::size_t size) { return decrypt_range(size, out); });
+#else
+      str.resize(N - 1);
+      decrypt_range(N - 1, str.data());
+#endif
+    }
+
+    /// Create the ChaCha20 context of the string.
+    /// \return The context.
+    [[nodiscard]] ChaChaContext context() const noexcept { return ChaChaContext{key_, key_algos_}; }
+
+    /// Get the raw (encrypted) content.
+    [[nodiscard]] const char *raw() const noexcept { return reinterpret_cast<const char *>(data_.data()); }
+
+    /// Get the actual length of the string.
+    [[nodiscard]] constexpr std::size_t size() const noexcept { return N - 1; }
+
+    /// Decrypt the encrypted string by small chunks and send them to a sink.
+    /// \param sink Callable object receiving each chunk of decrypted characters as a std::string_view.
+    /// \param size Maximal number of characters to decrypt (the whole string by default).
+    /// \remark Only a small buffer on the stack is used and it is erased after use.
+    template<typename Sink>
+    void decrypt_chunks(Sink &&sink, std::size_t size = N - 1) const {
+      const auto context = this->context();
+      std::array<char, details::OUTPUT_CHUNK_SIZE> chunk;
+      size = std::min(size, N - 1);
+      for(std::size_t pos = 0; pos < size; pos += chunk.size()) {
+        const auto nb_chars = std::min(size - pos, chunk.size());
+        std::copy_n(data_.begin() + pos, nb_chars, chunk.begin());
+        if(encrypted_) decrypt_chacha20(reinterpret_cast<Byte *>(chunk.data()), nb_chars, context, nonce_, pos);
+        sink(std::string_view{chunk.data(), nb_chars});
+      }
+      std::fill(chunk.begin(), chunk.end(), 0);
+    }
+
+    /// Decrypter of the characters of a string, one at a time.
+    /// \remark The key stream of the current block (64 characters) is cached. It is erased when the block changes
+    /// and when the cursor is destructed.
+    struct Cursor {
+      /// Destruct the cursor by first erasing the cached key stream.
+      constexpr ~Cursor() noexcept { details::erase(key_stream); }
+
+      /// Decrypt a character.
+      /// \param pos Position of the character in the string.
+      char operator()(std::size_t pos) const noexcept {
+        if(!string->encrypted_) return static_cast<char>(string->data_[pos]);
+        if(pos / details::chacha::BLOCK_SIZE != block) {
+          block = pos / details::chacha::BLOCK_SIZE;
+          auto state = string->context().state(string->nonce_);
+          details::erase(key_stream);
+          key_stream = details::chacha::block(state, static_cast<std::uint32_t>(block));
+          details::erase(state);
+        }
+        return static_cast<char>(string->data_[pos] ^ key_stream[pos % 64 / 4] >> 8 * (pos % 4));
+      }
+
+      /// The encrypted string.
+      const ChaChaString *string = nullptr;
+      /// Index of the block of the cached key stream.
+      mutable std::size_t block = SIZE_MAX;
+      /// Cached key stream.
+      mutable details::chacha::State key_stream{};
+    };
+
+    /// Get a view of the characters (without the terminal null byte), decrypted when they are accessed.
+    /// \remark The view refers to this string.
+    [[nodiscard]] constexpr DecodedView<Cursor> view() const & noexcept { return {Cursor{this}, N - 1}; }
+    /// A view of a temporary string would dangle.
+    void view() const && = delete;
+
+    /// Encrypted or decrypted data.
+    std::array<Byte, N> data_{};
+    /// Is the data encrypted (default) or decrypted (i.e. used)?
+    bool encrypted_ = true;
+    /// The nonce of the stream.
+    ChaChaNonce nonce_{};
+    /// The key used to encrypt the data (obfuscated).
+    ChaChaKey key_{};
+    /// Set of algorithms used for the obfuscation of the key.
+    Obfuscations key_algos_;
+
+  private:
+    /// Decrypt the beginning of the string.
+    /// \param size Number of characters to decrypt. It has to be less than N.
+    /// \param out Buffer receiving the decrypted characters.
+    /// \return The number of characters decrypted.
+    std::size_t decrypt_range(std::size_t size, char *out) const noexcept {
+      std::copy_n(data_.begin(), size, out);
+      if(encrypted_) decrypt_chacha20(reinterpret_cast<Byte *>(out), size, context(), nonce_);
+      return size;
+    }
+
+    /// Erase the information stored by the string (data, key and nonce)
+    constexpr void erase() noexcept {
+      if (encrypted_) return;
+      std::fill(data_.begin(), data_.end(), 0);
+      std::fill(key_.begin(), key_.end(), 0);
+      std::fill(nonce_.begin(), nonce_.end(), 0);
+    }
+
+    /// Run-time decryption
+    void decrypt_inplace() noexcept {
+      if(!encrypted_) return;
+      decrypt_chacha20(reinterpret_cast<Byte*>(data_.data()), N, context(), nonce_);
+      encrypted_ = false;
+    }
+  };
+
+  /// Write an encrypted string to an output stream, without decrypting it in-place.
+  /// \remark The string is decrypted by small chunks. The width, fill and adjustment of the stream are honored.
+  template<std::size_t N, Conversion C>
+  std::ostream &operator<<(std::ostream &os, const ChaChaString<N, C> &str) {
+    return details::write_chunks(os, str.size(), [&](auto &&sink, std::size_t size) { str.decrypt_chunks(sink, size); });
+  }
+
+  /// User-defined literal "_chacha"
+  template<ChaChaString str>
+  consteval auto operator""_chacha() { return str; }
+
+  /// User-defined literal "_chacha_fast" (conversions of the decrypted string skip the obfuscated call)
+  template<details::Literal str>
+  consteval auto operator""_chacha_fast() { return ChaChaString<sizeof(str.chars), Conversion::FAST>{str.chars}; }
+}
+
+#endif
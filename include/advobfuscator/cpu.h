@@ -0,0 +1,108 @@
+// ADVobfuscator - Detection of CPU features at runtime
+//
+// Copyright (c) 2025, Sebastien Andrivet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+// following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+// disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+// following disclaimer in the documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+// products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+// USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Get latest version on https://github.com/andrivet/ADVobfuscator
+
+#ifndef ADVOBFUSCATOR_CPU_H
+#define ADVOBFUSCATOR_CPU_H
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define ADVOBFUSCATOR_X86_64 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+// Enable instructions sets for a single function (GCC and Clang). Visual C++ does not need it.
+#if defined(__GNUC__) || defined(__clang__)
+#define ADVOBFUSCATOR_TARGET(features) __attribute__((target(features)))
+#else
+#define ADVOBFUSCATOR_TARGET(features)
+#endif
+
+namespace andrivet::advobfuscator::cpu {
+
+#if defined(ADVOBFUSCATOR_X86_64)
+
+  namespace details {
+    /// Detect if the CPU and the OS support AVX2.
+    inline bool detect_avx2() noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+      int info[4];
+      __cpuid(info, 0);
+      if(info[0] < 7) return false;
+      __cpuid(info, 1);
+      // OSXSAVE and AVX, then the OS has to save the YMM registers
+      if((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return false;
+      if((_xgetbv(0) & 0x06) != 0x06) return false;
+      __cpuidex(info, 7, 0);
+      return (info[1] & (1 << 5)) != 0;
+#else
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    /// Detect if the CPU supports the AES instructions (AES-NI).
+    inline bool detect_aesni() noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+      int info[4];
+      __cpuid(info, 1);
+      return (info[2] & (1 << 25)) != 0;
+#else
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("aes");
+#endif
+    }
+  }
+
+  /// Is AVX2 supported by this CPU?
+  /// \remark The detection is done only once.
+  [[nodiscard]] inline bool has_avx2() noexcept {
+    static const bool avx2 = details::detect_avx2();
+    return avx2;
+  }
+
+  /// Are the AES instructions (AES-NI) supported by this CPU?
+  /// \remark The detection is done only once.
+  [[nodiscard]] inline bool has_aesni() noexcept {
+    static const bool aesni = details::detect_aesni();
+    return aesni;
+  }
+
+#else
+
+  /// Is AVX2 supported by this CPU?
+  [[nodiscard]] inline bool has_avx2() noexcept { return false; }
+
+  /// Are the AES instructions (AES-NI) supported by this CPU?
+  [[nodiscard]] inline bool has_aesni() noexcept { return false; }
+
+#endif
+
+}
+
+#endif
@@ -0,0 +1,82 @@
+// ADVobfuscator - Strings of characters with a fixed capacity
+//
+// Copyright (c) 2025, Sebastien Andrivet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+// following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+// disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+// following disclaimer in the documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+// products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+// USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Get latest version on https://github.com/andrivet/ADVobfuscator
+
+#ifndef ADVOBFUSCATOR_FIXED_STRING_H
+#define ADVOBFUSCATOR_FIXED_STRING_H
+
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+namespace andrivet::advobfuscator {
+
+  /// A string of characters stored in place (no heap allocation), used to return decoded strings.
+  /// \tparam N The capacity of the string (including the null terminal byte).
+  template<std::size_t N>
+  struct FixedString {
+    /// Destruct the string by first erasing its content.
+    /// \remark The erasing may be omitted by the compiler.
+    constexpr ~FixedString() noexcept { std::fill(data_.begin(), data_.end(), 0); }
+
+    /// Get the characters of the string (terminated by a null byte).
+    [[nodiscard]] constexpr const char *c_str() const noexcept { return data_.data(); }
+    /// Get the characters of the string (terminated by a null byte).
+    [[nodiscard]] constexpr const char *data() const noexcept { return data_.data(); }
+    /// Get the number of characters of the string.
+    [[nodiscard]] constexpr std::size_t size() const noexcept { return size_; }
+    /// Is the string empty?
+    [[nodiscard]] constexpr bool empty() const noexcept { return size_ == 0; }
+
+    [[nodiscard]] constexpr const char *begin() const noexcept { return data_.data(); }
+    [[nodiscard]] constexpr const char *end() const noexcept { return data_.data() + size_; }
+
+    /// Implicit conversion to a view of the characters.
+    constexpr operator std::string_view() const noexcept { return {data_.data(), size_}; }
+
+    /// Compare the characters of the string.
+    friend constexpr bool operator==(const FixedString &s0, std::string_view s1) noexcept {
+      return static_cast<std::string_view>(s0) == s1;
+    }
+
+    /// The characters of the string followed by a null byte.
+    std::array<char, N> data_{};
+    /// The number of characters of the string.
+    std::size_t size_ = 0;
+  };
+
+  namespace details {
+    /// String literal used as a template parameter, to construct a string with given parameters (policy, conversion).
+    template<std::size_t N>
+    struct Literal {
+      consteval Literal(const char (&str)[N]) noexcept { std::copy(str, str + N, chars); }
+      char chars[N]{};
+    };
+  }
+}
+
+#endif
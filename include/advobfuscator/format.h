@@ -28,31 +28,93 @@
 #ifndef ADVOBFUSCATOR_FORMAT_H
 #define ADVOBFUSCATOR_FORMAT_H
 
+#include <cstddef>
+#include <algorithm>
 #include <format>
+#include <string_view>
 #include "string.h"
 #include "aes_string.h"
+#include "chacha_string.h"
 
-/// Formatter for Obfuscated strings
-template<std::size_t N>
-struct std::formatter<andrivet::advobfuscator::ObfuscatedString<N>> {
-  constexpr auto parse(std::format_parse_context& ctx) {
-    return ctx.begin();
-  }
+namespace andrivet::advobfuscator::details {
+  /// Common part of the formatters of obfuscated and encrypted strings.
+  /// Strings are decoded by small chunks and sent directly to the output, without allocating memory.
+  /// Supported specification: [[fill]align][width][.precision][s]
+  struct ChunkedStringFormatter {
+    constexpr auto parse(std::format_parse_context &ctx) {
+      auto it = ctx.begin();
+      const auto end = ctx.end();
+      const auto is_align = [](char c) { return c == '<' || c == '>' || c == '^'; };
+
+      if(it != end && it + 1 != end && is_align(*(it + 1)) && *it != '{' && *it != '}') {
+        fill_ = *it;
+        align_ = *(it + 1);
+        it += 2;
+      }
+      else if(it != end && is_align(*it))
+        align_ = *it++;
+
+      while(it != end && *it >= '0' && *it <= '9')
+        width_ = width_ * 10 + static_cast<std::size_t>(*it++ - '0');
+
+      if(it != end && *it == '.') {
+        if(++it == end || *it < '0' || *it > '9')
+          throw std::format_error("Invalid precision for an obfuscated string");
+        precision_ = 0;
+        while(it != end && *it >= '0' && *it <= '9')
+          precision_ = precision_ * 10 + static_cast<std::size_t>(*it++ - '0');
+      }
+
+      if(it != end && *it == 's') ++it;
+      if(it != end && *it != '}')
+        throw std::format_error("Invalid format specification for an obfuscated string");
+      return it;
+    }
 
-  auto format(const andrivet::advobfuscator::ObfuscatedString<N> &s, std::format_context& ctx) const {
-    return std::format_to(ctx.out(), "{}", s.decode());
+    /// Format characters produced by chunks.
+    /// \param size The total number of characters.
+    /// \param chunks Callable object producing (up to a size) the chunks of characters and sending them to a sink.
+    /// \param ctx Format context.
+    template<typename Chunks>
+    auto format(std::size_t size, Chunks &&chunks, std::format_context &ctx) const {
+      size = std::min(size, precision_);
+      const auto padding = width_ > size ? width_ - size : 0;
+      const auto before = align_ == '>' ? padding : align_ == '^' ? padding / 2 : 0;
+
+      auto out = std::fill_n(ctx.out(), before, fill_);
+      chunks([&](std::string_view chunk) { out = std::copy(chunk.begin(), chunk.end(), out); }, size);
+      return std::fill_n(out, padding - before, fill_);
+    }
+
+  private:
+    char fill_ = ' ';
+    char align_ = '<';
+    std::size_t width_ = 0;
+    std::size_t precision_ = static_cast<std::size_t>(-1);
+  };
+}
+
+/// Formatter for Obfuscated strings
+template<std::size_t N, andrivet::advobfuscator::Conversion C>
+struct std::formatter<andrivet::advobfuscator::ObfuscatedString<N, C>>: andrivet::advobfuscator::details::ChunkedStringFormatter {
+  auto format(const andrivet::advobfuscator::ObfuscatedString<N, C> &s, std::format_context& ctx) const {
+    return ChunkedStringFormatter::format(s.size(), [&](auto &&sink, std::size_t size) { s.decode_chunks(sink, size); }, ctx);
   }
 };
 
 /// Formatter for encrypted strings (AES)
-template<std::size_t N>
-struct std::formatter<andrivet::advobfuscator::AesString<N>> {
-  constexpr auto parse(std::format_parse_context& ctx) {
-    return ctx.begin();
+template<std::size_t N, typename Policy, andrivet::advobfuscator::Conversion C>
+struct std::formatter<andrivet::advobfuscator::AesString<N, Policy, C>>: andrivet::advobfuscator::details::ChunkedStringFormatter {
+  auto format(const andrivet::advobfuscator::AesString<N, Policy, C> &s, std::format_context& ctx) const {
+    return ChunkedStringFormatter::format(s.size(), [&](auto &&sink, std::size_t size) { s.decrypt_chunks(sink, size); }, ctx);
   }
+};
 
-  auto format(const andrivet::advobfuscator::AesString<N> &s, std::format_context& ctx) const {
-    return std::format_to(ctx.out(), "{}", s.decrypt());
+/// Formatter for encrypted strings (ChaCha20)
+template<std::size_t N, andrivet::advobfuscator::Conversion C>
+struct std::formatter<andrivet::advobfuscator::ChaChaString<N, C>>: andrivet::advobfuscator::details::ChunkedStringFormatter {
+  auto format(const andrivet::advobfuscator::ChaChaString<N, C> &s, std::format_context& ctx) const {
+    return ChunkedStringFormatter::format(s.size(), [&](auto &&sink, std::size_t size) { s.decrypt_chunks(sink, size); }, ctx);
   }
 };
 
@@ -29,14 +29,14 @@
 #define ADVOBFUSCATOR_FSM_H
 
 #include <cstdint>
+#include <array>
 #include <tuple>
 #include <utility>
+#include "random.h"
 
 namespace andrivet::advobfuscator {
 
   constexpr size_t NB_BITS = 32; ///< Number of bits recognized.
-  constexpr size_t TRANSITIONS_PER_BIT = 8; ///< Number of transitions per bit.
-  constexpr size_t MAX_TRANSITIONS = NB_BITS * TRANSITIONS_PER_BIT; ///< Total number of transitions.
 
   // For each bit to recognize, we create a small FSM of 4 states and 8 transitions.
   // - The first transition moves the recognizer to the next state.
@@ -68,32 +68,45 @@ namespace andrivet::advobfuscator {
     };
   }
 
+  namespace details {
+    /// A transition packed in 16 bits.
+    struct PackedTransition {
+      std::uint16_t to : 8;     ///< To this state.
+      std::uint16_t active : 1; ///< Does the transition hold the object (index of the payload)?
+      std::uint16_t valid : 1;  ///< Is there a transition (0 for a missing one)?
+    };
+  }
+
   /// A finite state machine that recognizes a number bit per bit,
-  template<typename O>
+  /// \tparam O Type of the object stored.
+  /// \tparam Bits Maximal number of bits of the number recognized (the size of the table depends on it).
+  template<typename O, std::size_t Bits = NB_BITS>
   struct Fsm {
     /// Construct a new finite state machine that recognizes a number and stores an object.
     /// \param recognize The number to be recognized by this finite state machine.
     /// \param o The object stored in one of the transition (the active one).
-    consteval Fsm(std::uint32_t recognize, O o) {
+    consteval Fsm(std::uint32_t recognize, O o): o_{o} {
       // Get a random number for the activate transition of the recognizer.
       // The activate transition is the transition that stores the object.
-      const std::uint32_t activate = generate_random_not_0<uint32_t>(recognize % 1000, NB_BITS - 1);
       auto bits = details::num_bits(recognize);
+      if(bits > static_cast<int>(Bits)) throw std::exception(); // Bits is too small
+      // Between 1 and the number of bits: the active transition has to be reached by the recognizer
+      const std::uint32_t activate = generate_random_not_0<uint32_t>(recognize % 1000, static_cast<std::uint32_t>(bits + 1));
 
       // For each bit...
       for(int i = 0; i < bits; ++i) {
         // Get the bit's value
         bool bit = (recognize >> (bits - 1 - i)) & 0x01;
         // Transition to the next state of the recognizer and store (or not) the object
-        add_transition(bit, 4 * i, 4 * i + 4, i + 1 == activate ? o : O{});
+        add_transition(bit, 4 * i, 4 * i + 4, static_cast<std::uint32_t>(i + 1) == activate);
         // Transition to states in an infinite loop
-        add_transition(!bit, 4 * i, 4 * i + 1, O{});
-        add_transition(0, 4 * i + 1, 4 * i + 2, O{});
-        add_transition(1, 4 * i + 1, 4 * i + 3, O{});
-        add_transition(0, 4 * i + 2, 4 * i + 3, O{});
-        add_transition(1, 4 * i + 2, 4 * i + 1, O{});
-        add_transition(0, 4 * i + 3, 4 * i + 1, O{});
-        add_transition(0, 4 * i + 3, 4 * i + 2, O{});
+        add_transition(!bit, 4 * i, 4 * i + 1);
+        add_transition(0, 4 * i + 1, 4 * i + 2);
+        add_transition(1, 4 * i + 1, 4 * i + 3);
+        add_transition(0, 4 * i + 2, 4 * i + 3);
+        add_transition(1, 4 * i + 2, 4 * i + 1);
+        add_transition(0, 4 * i + 3, 4 * i + 1);
+        add_transition(0, 4 * i + 3, 4 * i + 2);
       }
     }
 
@@ -101,10 +114,14 @@ namespace andrivet::advobfuscator {
     /// \param input Input value.
     /// \param from From state.
     /// \param to To state.
-    /// \param o Object to be stored in transition.
-    consteval void add_transition(bool input, int from, int to, O o) {
-      if(nb_transition_ >= MAX_TRANSITIONS) throw std::exception(); // MAX_TRANSITIONS is too small
-      transitions_[nb_transition_++] = {.input = input, .from = from, .to = to, .o = o};
+    /// \param active Is the object stored in the transition?
+    /// \remark If there are several transitions for the same state and input, the first one added is used.
+    consteval void add_transition(bool input, int from, int to, bool active = false) {
+      auto &transition = table_[from][input];
+      if(transition.valid) return;
+      transition.to = static_cast<std::uint16_t>(to);
+      transition.active = active;
+      transition.valid = 1;
     }
 
     /// Find a transition from a state and with an input value.
@@ -114,12 +131,12 @@ namespace andrivet::advobfuscator {
     /// \exception The FSM is supposed to cover all the cases and this member function will always find
     /// a transition. If it is not the case, there is a bug in the generation of the FSM.
     /// In this case, an exception is raised.
-    [[nodiscard]] constexpr const details::Transition<O> &find(int state, bool input) const {
-      for(int i = 0; i < nb_transition_; ++i) {
-        if(transitions_[i].from == state && transitions_[i].input == input)
-          return transitions_[i];
-      }
-      throw std::exception(); // Missing transition in the FSM (i.e. a bug)
+    /// \remark The transition is found directly in a table indexed by the state and the input value.
+    [[nodiscard]] constexpr details::Transition<O> find(int state, bool input) const {
+      const auto transition = table_[state][input];
+      if(!transition.valid) [[unlikely]]
+        throw std::exception(); // Missing transition in the FSM (i.e. a bug)
+      return {.input = input, .from = state, .to = transition.to, .o = transition.active ? o_ : O{}};
     }
 
     /// Run the finite state machine on a number.
@@ -135,19 +152,21 @@ namespace andrivet::advobfuscator {
         // Get the value of the bit.
         bool bit = (value >> i) & 1;
         // Find the transition
-        auto &transition = find(state, bit);
+        const auto transition = table_[state][bit];
+        if(!transition.valid) [[unlikely]]
+          throw std::exception(); // Missing transition in the FSM (i.e. a bug)
         // Update the state.
         state = transition.to;
         // Treat the active transition as a final state.
-        if(transition.o != O{}) return transition.o;
+        if(transition.active) return o_;
       }
       throw std::exception(); // Invalid FSM (i.e.bug);
     }
 
-    /// Transitions of the finite state machine
-    std::array<details::Transition<O>, MAX_TRANSITIONS> transitions_{};
-    /// Number of transitions
-    std::size_t nb_transition_{};
+    /// Transitions of the finite state machine, for each state and input value (4 states per bit and a final one)
+    std::array<std::array<details::PackedTransition, 2>, Bits * 4 + 1> table_{};
+    /// Object stored in the active transition
+    O o_{};
   };
 }
 
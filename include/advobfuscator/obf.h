@@ -28,11 +28,17 @@
 #ifndef ADVOBFUSCATOR_OBF_H
 #define ADVOBFUSCATOR_OBF_H
 
+#include <cstdint>
+#include <algorithm>
 #include <array>
 #include <bit>
+#include <type_traits>
 #include "random.h"
+#include "cpu.h"
 
 namespace andrivet::advobfuscator {
+  // I prefer to use std::uin8_t instead of std::byte for the implicit conversions (from int)
+  using Byte = std::uint8_t;
 
   /// Algorithms to encode data
   enum class DataAlgorithm {
@@ -70,6 +76,30 @@ namespace andrivet::advobfuscator {
     static const std::size_t MIN_NB_ALGORITHMS = 2;
     /// Maximal number of algorithms
     static const std::size_t MAX_NB_ALGORITHMS = 4;
+    /// Number of bytes decoded at once by all the algorithms (large enough for the vectorized loops)
+    static const std::size_t DECODE_CHUNK_SIZE = 256;
+
+    /// Erase an array holding secrets.
+    /// \param data The array to erase.
+    /// \remark At runtime, the bytes are erased through a volatile pointer so the compiler does not elide the stores.
+    template<typename T, std::size_t N>
+    constexpr void erase(std::array<T, N> &data) noexcept {
+      if(std::is_constant_evaluated()) {
+        std::fill(data.begin(), data.end(), T{});
+        return;
+      }
+      volatile auto *bytes = reinterpret_cast<volatile unsigned char *>(data.data());
+      for(std::size_t i = 0; i < sizeof(data); ++i) bytes[i] = 0;
+    }
+
+    /// Erase an array holding secrets (at runtime).
+    /// \param data The array to erase.
+    /// \remark The bytes are erased through a volatile pointer so the compiler does not elide the stores.
+    template<typename T, std::size_t N>
+    void erase(T (&data)[N]) noexcept {
+      volatile auto *bytes = reinterpret_cast<volatile unsigned char *>(data);
+      for(std::size_t i = 0; i < sizeof(data); ++i) bytes[i] = 0;
+    }
 
     /// Substitute bits in a byte.
     /// \param b Input byte.
@@ -140,6 +170,230 @@ namespace andrivet::advobfuscator {
     constexpr uint8_t swap(uint8_t b) {
         return ((b & 0xF0) >> 4) | ((b & 0x0F) << 4);
     }
+
+    /// Decode a byte with an algorithm known at compile time.
+    /// \tparam D Algorithm used to encode the byte.
+    /// \param b Input byte.
+    /// \param key Key to be used for the decoding.
+    /// \return The decoded byte.
+    template<DataAlgorithm D>
+    constexpr uint8_t decode(uint8_t b, uint8_t key) {
+      using enum DataAlgorithm;
+      if constexpr(D == CAESAR) return caesar_inverted(b, key);
+      else if constexpr(D == XOR) return x0r(b, key);
+      else if constexpr(D == ROTATE) return rotate_inverted(b, key);
+      else if constexpr(D == SUBSTITUTE) return substitute(b, key);
+      else return b;
+    }
+
+    /// Compute the next key with an algorithm known at compile time.
+    /// \tparam K Algorithm used to compute the next key.
+    /// \param key The current key.
+    /// \return The new key computed from the given key.
+    template<KeyAlgorithm K>
+    constexpr uint8_t next_key(uint8_t key) {
+      using enum KeyAlgorithm;
+      if constexpr(K == INCREMENT) return static_cast<std::uint8_t>((key + 1) % 256);
+      else if constexpr(K == INVERT) return x0r(key, 0xFF);
+      else if constexpr(K == SUBSTITUTE) return substitute(key, 7);
+      else if constexpr(K == SWAP) return swap(key);
+      else return key;
+    }
+
+    /// Compute the key at a given position with an algorithm known at compile time.
+    /// \tparam K Algorithm used to compute the next key.
+    /// \param key The key at position 0.
+    /// \param pos Position in the data.
+    /// \return The key at this position.
+    /// \remark Every key algorithm is periodic: INVERT, SUBSTITUTE and SWAP are involutions (period 2),
+    /// INCREMENT wraps around every 256 steps.
+    template<KeyAlgorithm K>
+    constexpr uint8_t key_at(uint8_t key, std::size_t pos) {
+      if constexpr(K == KeyAlgorithm::INCREMENT) return static_cast<std::uint8_t>((key + pos) % 256);
+      else return pos % 2 ? next_key<K>(key) : key;
+    }
+  }
+
+  // ------------------------------------------------------------------
+  // Vectorized decoding (x86-64)
+  // ------------------------------------------------------------------
+
+#if defined(ADVOBFUSCATOR_X86_64)
+
+  // Keys are expanded in vector registers: INVERT, SUBSTITUTE and SWAP have a period of 2, so the vector of keys
+  // is the same for every group of bytes; INCREMENT adds the width of the vector to each key.
+  // Rotations of bytes by a variable number of bits are done in 3 steps (1, 2 and 4 bits) selected by a mask.
+  // SUBSTITUTE is a rotation of the reversed bits: substitute(b, d) = rotl(reverse(b), d + 1).
+
+  namespace details::sse2 {
+    using V = __m128i;
+    /// Number of bytes decoded at once.
+    static const std::size_t WIDTH = 16;
+
+    inline V set1(std::uint8_t b) noexcept { return _mm_set1_epi8(static_cast<char>(b)); }
+
+    /// Select bytes from x (bit of r not set) or from y (bit of r set).
+    inline V select(V x, V y, V r, std::uint8_t bit) noexcept {
+      const V mask = _mm_cmpeq_epi8(_mm_and_si128(r, set1(bit)), set1(bit));
+      return _mm_or_si128(_mm_andnot_si128(mask, x), _mm_and_si128(mask, y));
+    }
+
+    /// Rotate left the bits of each byte by a constant.
+    template<int C>
+    inline V rotl(V x) noexcept {
+      return _mm_or_si128(
+        _mm_and_si128(_mm_slli_epi16(x, C), set1(static_cast<std::uint8_t>(0xFF << C))),
+        _mm_and_si128(_mm_srli_epi16(x, 8 - C), set1(static_cast<std::uint8_t>(0xFF >> (8 - C)))));
+    }
+
+    /// Rotate left the bits of each byte by the corresponding byte of r (modulo 8).
+    inline V rotl(V x, V r) noexcept {
+      x = select(x, rotl<1>(x), r, 1);
+      x = select(x, rotl<2>(x), r, 2);
+      return select(x, rotl<4>(x), r, 4);
+    }
+
+    /// Reverse the bits of each byte.
+    inline V reverse(V x) noexcept {
+      x = rotl<4>(x);
+      x = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(x, 2), set1(0x33)), _mm_and_si128(_mm_slli_epi16(x, 2), set1(0xCC)));
+      return _mm_or_si128(_mm_and_si128(_mm_srli_epi16(x, 1), set1(0x55)), _mm_and_si128(_mm_slli_epi16(x, 1), set1(0xAA)));
+    }
+
+    /// Decode bytes with their keys.
+    template<DataAlgorithm D>
+    inline V decode(V x, V k) noexcept {
+      using enum DataAlgorithm;
+      if constexpr(D == CAESAR) return _mm_sub_epi8(x, k);
+      else if constexpr(D == XOR) return _mm_xor_si128(x, k);
+      else if constexpr(D == ROTATE) return rotl(x, _mm_sub_epi8(_mm_setzero_si128(), k));
+      else if constexpr(D == SUBSTITUTE) return rotl(reverse(x), _mm_add_epi8(k, set1(1)));
+      else return x;
+    }
+
+    /// Decode in-place a block of bytes, 16 bytes at a time.
+    /// \return The number of bytes decoded (a multiple of 16).
+    template<DataAlgorithm D, KeyAlgorithm K>
+    inline std::size_t decode_block(std::uint8_t *data, std::size_t size, std::uint8_t key) noexcept {
+      alignas(16) std::array<std::uint8_t, WIDTH> keys;
+      for(std::size_t i = 0; i < WIDTH; ++i, key = next_key<K>(key)) keys[i] = key;
+      V k = _mm_load_si128(reinterpret_cast<const V *>(keys.data()));
+
+      std::size_t i = 0;
+      for(; i + WIDTH <= size; i += WIDTH) {
+        auto p = reinterpret_cast<V *>(data + i);
+        _mm_storeu_si128(p, decode<D>(_mm_loadu_si128(p), k));
+        if constexpr(K == KeyAlgorithm::INCREMENT) k = _mm_add_epi8(k, set1(WIDTH));
+      }
+      return i;
+    }
+  }
+
+  namespace details::avx2 {
+    using V = __m256i;
+    /// Number of bytes decoded at once.
+    static const std::size_t WIDTH = 32;
+
+    ADVOBFUSCATOR_TARGET("avx2")
+    inline V set1(std::uint8_t b) noexcept { return _mm256_set1_epi8(static_cast<char>(b)); }
+
+    /// Select bytes from x (bit of r not set) or from y (bit of r set).
+    ADVOBFUSCATOR_TARGET("avx2")
+    inline V select(V x, V y, V r, std::uint8_t bit) noexcept {
+      return _mm256_blendv_epi8(x, y, _mm256_cmpeq_epi8(_mm256_and_si256(r, set1(bit)), set1(bit)));
+    }
+
+    /// Rotate left the bits of each byte by a constant.
+    template<int C>
+    ADVOBFUSCATOR_TARGET("avx2")
+    inline V rotl(V x) noexcept {
+      return _mm256_or_si256(
+        _mm256_and_si256(_mm256_slli_epi16(x, C), set1(static_cast<std::uint8_t>(0xFF << C))),
+        _mm256_and_si256(_mm256_srli_epi16(x, 8 - C), set1(static_cast<std::uint8_t>(0xFF >> (8 - C)))));
+    }
+
+    /// Rotate left the bits of each byte by the corresponding byte of r (modulo 8).
+    ADVOBFUSCATOR_TARGET("avx2")
+    inline V rotl(V x, V r) noexcept {
+      x = select(x, rotl<1>(x), r, 1);
+      x = select(x, rotl<2>(x), r, 2);
+      return select(x, rotl<4>(x), r, 4);
+    }
+
+    /// Reverse the bits of each byte.
+    ADVOBFUSCATOR_TARGET("avx2")
+    inline V reverse(V x) noexcept {
+      x = rotl<4>(x);
+      x = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(x, 2), set1(0x33)), _mm256_and_si256(_mm256_slli_epi16(x, 2), set1(0xCC)));
+      return _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(x, 1), set1(0x55)), _mm256_and_si256(_mm256_slli_epi16(x, 1), set1(0xAA)));
+    }
+
+    /// Decode bytes with their keys.
+    template<DataAlgorithm D>
+    ADVOBFUSCATOR_TARGET("avx2")
+    inline V decode(V x, V k) noexcept {
+      using enum DataAlgorithm;
+      if constexpr(D == CAESAR) return _mm256_sub_epi8(x, k);
+      else if constexpr(D == XOR) return _mm256_xor_si256(x, k);
+      else if constexpr(D == ROTATE) return rotl(x, _mm256_sub_epi8(_mm256_setzero_si256(), k));
+      else if constexpr(D == SUBSTITUTE) return rotl(reverse(x), _mm256_add_epi8(k, set1(1)));
+      else return x;
+    }
+
+    /// Decode in-place a block of bytes, 32 bytes at a time.
+    /// \return The number of bytes decoded (a multiple of 32).
+    template<DataAlgorithm D, KeyAlgorithm K>
+    ADVOBFUSCATOR_TARGET("avx2")
+    inline std::size_t decode_block(std::uint8_t *data, std::size_t size, std::uint8_t key) noexcept {
+      alignas(32) std::array<std::uint8_t, WIDTH> keys;
+      for(std::size_t i = 0; i < WIDTH; ++i, key = next_key<K>(key)) keys[i] = key;
+      V k = _mm256_load_si256(reinterpret_cast<const V *>(keys.data()));
+
+      std::size_t i = 0;
+      for(; i + WIDTH <= size; i += WIDTH) {
+        auto p = reinterpret_cast<V *>(data + i);
+        _mm256_storeu_si256(p, decode<D>(_mm256_loadu_si256(p), k));
+        if constexpr(K == KeyAlgorithm::INCREMENT) k = _mm256_add_epi8(k, set1(WIDTH));
+      }
+      return i;
+    }
+  }
+
+#endif
+
+  namespace details {
+    /// Decode in-place the beginning of a block of bytes with vector instructions, if they are available.
+    /// \return The number of bytes decoded.
+    template<DataAlgorithm D, KeyAlgorithm K>
+    inline std::size_t decode_block_simd([[maybe_unused]] uint8_t *data, [[maybe_unused]] std::size_t size,
+                                         [[maybe_unused]] uint8_t key) noexcept {
+#if defined(ADVOBFUSCATOR_X86_64)
+      if(size >= avx2::WIDTH && cpu::has_avx2()) return avx2::decode_block<D, K>(data, size, key);
+      if(size >= sse2::WIDTH) return sse2::decode_block<D, K>(data, size, key);
+#endif
+      return 0;
+    }
+
+    /// Decode in-place a block of bytes with algorithms known at compile time.
+    /// \tparam D Algorithm used to encode the data.
+    /// \tparam K Algorithm used to compute the next key.
+    /// \param data Bytes to decode.
+    /// \param size Number of bytes to decode.
+    /// \param key Key of the first byte.
+    /// \return The key of the byte following the block.
+    /// \remark At runtime, vector instructions are used for the largest part of the block.
+    template<DataAlgorithm D, KeyAlgorithm K>
+    constexpr uint8_t decode_block(uint8_t *data, std::size_t size, uint8_t key) noexcept {
+      if(!std::is_constant_evaluated()) {
+        const auto done = decode_block_simd<D, K>(data, size, key);
+        key = key_at<K>(key, done);
+        data += done;
+        size -= done;
+      }
+      for(std::size_t i = 0; i < size; ++i, key = next_key<K>(key))
+        data[i] = decode<D>(data[i], key);
+      return key;
+    }
   }
 
   // ------------------------------------------------------------------
@@ -212,14 +466,47 @@ namespace andrivet::advobfuscator {
       return key;
     }
 
+    /// Decode in-place a block of bytes.
+    /// \param data Bytes to decode.
+    /// \param size Number of bytes to decode.
+    /// \param key Key of the first byte.
+    /// \return The key of the byte following the block.
+    /// \remark The algorithms are selected once, the loop over the bytes is specialized for them.
+    constexpr std::uint8_t decode_block(std::uint8_t *data, std::size_t size, std::uint8_t key) const noexcept {
+      switch(parameters_.data_algo) {
+        using enum DataAlgorithm;
+        case CAESAR: return decode_block<CAESAR>(data, size, key);
+        case XOR: return decode_block<XOR>(data, size, key);
+        case ROTATE: return decode_block<ROTATE>(data, size, key);
+        case SUBSTITUTE: return decode_block<SUBSTITUTE>(data, size, key);
+        default: return key; // Identity (or invalid) algorithm: nothing to decode
+      }
+    }
+
+    /// Compute the key at a given position without walking the key schedule.
+    /// \param pos Position in the data.
+    /// \return The key used to encode or decode the byte at this position.
+    [[nodiscard]] constexpr std::uint8_t key_at(std::size_t pos) const {
+      const auto key = parameters_.key;
+      switch(parameters_.key_algo) {
+        using enum KeyAlgorithm;
+        case IDENTITY: break;
+        case INCREMENT: return details::key_at<INCREMENT>(key, pos);
+        case INVERT: return details::key_at<INVERT>(key, pos);
+        case SUBSTITUTE: return details::key_at<SUBSTITUTE>(key, pos);
+        case SWAP: return details::key_at<SWAP>(key, pos);
+        default: throw std::exception(); // Invalid key encoding;
+      }
+      return key;
+    }
+
     /// Encode a range of data.
     /// \param begin_pos Relative position of the beginning of the range from the whole data.
     /// \param begin Pointer to the first byte to encode.
     /// \param end Pointer past the last byte to encode.
     template<typename It>
     consteval void encode(std::size_t begin_pos, It begin, It end) const noexcept {
-      auto key = parameters_.key;
-      while(begin_pos-- > 0) key = next_key(key);
+      auto key = key_at(begin_pos);
       for(auto current = begin; current < end; key = next_key(key), ++current)
         *current = encode(*current, key);
     }
@@ -230,12 +517,25 @@ namespace andrivet::advobfuscator {
     /// \param end Pointer past the last byte to decode.
     template<typename It>
     constexpr void decode(std::size_t begin_pos, It begin, It end) const noexcept {
-      auto key = parameters_.key;
-      while(begin_pos-- > 0) key = next_key(key);
+      auto key = key_at(begin_pos);
       for(auto current = begin; current < end; key = next_key(key), ++current)
         *current = decode(*current, key);
     }
 
+    /// Decode in-place a block of bytes with a data algorithm known at compile time.
+    /// \tparam D Algorithm used to encode the data.
+    template<DataAlgorithm D>
+    constexpr std::uint8_t decode_block(std::uint8_t *data, std::size_t size, std::uint8_t key) const noexcept {
+      switch(parameters_.key_algo) {
+        using enum KeyAlgorithm;
+        case INCREMENT: return details::decode_block<D, INCREMENT>(data, size, key);
+        case INVERT: return details::decode_block<D, INVERT>(data, size, key);
+        case SUBSTITUTE: return details::decode_block<D, SUBSTITUTE>(data, size, key);
+        case SWAP: return details::decode_block<D, SWAP>(data, size, key);
+        default: return details::decode_block<D, IDENTITY>(data, size, key);
+      }
+    }
+
     /// Get the current key for the obfuscation
     [[nodiscard]] constexpr std::uint8_t key() const noexcept { return parameters_.key; }
 
@@ -296,12 +596,12 @@ namespace andrivet::advobfuscator {
         counter,
         generate_random(counter, details::MIN_NB_ALGORITHMS, details::MAX_NB_ALGORITHMS),
         std::make_index_sequence<details::MAX_NB_ALGORITHMS>{}
-    )} {}
+    )} { compact(); }
 
     /// Construct a set of obfuscations with explicit parameters.
     /// \param params Parameters for the obfuscation (key and algorithms).
     consteval explicit Obfuscations(const Parameters &params) noexcept
-    : algos_{details::make_algorithm(params)} {}
+    : algos_{details::make_algorithm(params)} { compact(); }
 
     /// Construct a set of obfuscations with explicit parameters.
     /// \param params Array of parameters for the obfuscation (key and algorithms).
@@ -309,7 +609,7 @@ namespace andrivet::advobfuscator {
     consteval explicit Obfuscations(const Parameters (&params)[A]) noexcept
     : algos_{details::make_algorithms<A>(
       params,
-      std::make_index_sequence<details::MAX_NB_ALGORITHMS>{})} {}
+      std::make_index_sequence<details::MAX_NB_ALGORITHMS>{})} { compact(); }
 
     /// Encode a range of data.
     /// \param begin_pos Relative position of the beginning of the range from the whole data.
@@ -317,20 +617,44 @@ namespace andrivet::advobfuscator {
     /// \param end Pointer past the last byte to encode.
     template<typename It>
     consteval void encode(std::size_t begin_pos, It begin, It end) const {
-      for(std::size_t i = 0; i < details::MAX_NB_ALGORITHMS; ++i)
-        algos_[i].encode(begin_pos, begin, end);
+      std::array<std::uint8_t, details::MAX_NB_ALGORITHMS> keys{};
+      for(std::size_t i = 0; i < nb_algos_; ++i) keys[i] = algos_[i].key_at(begin_pos);
+
+      for(auto current = begin; current < end; ++current) {
+        std::uint8_t b = *current;
+        for(std::size_t i = 0; i < nb_algos_; ++i) {
+          b = algos_[i].encode(b, keys[i]);
+          keys[i] = algos_[i].next_key(keys[i]);
+        }
+        *current = b;
+      }
     }
 
     /// Decode a range of data.
     /// \param begin_pos Relative position of the beginning of the range from the whole data.
     /// \param begin Pointer to the first byte to decode.
     /// \param end Pointer past the last byte to decode.
+    /// \remark The data is read only once: it is decoded by chunks small enough to stay in cache while all the
+    /// layers are applied to them.
     template<typename It>
     constexpr void decode(std::size_t begin_pos, It begin, It end) const noexcept {
-      for(std::size_t i = 0; i < details::MAX_NB_ALGORITHMS; ++i)
-        algos_[details::MAX_NB_ALGORITHMS - i - 1].decode(begin_pos, begin, end);
+      std::array<std::uint8_t, details::MAX_NB_ALGORITHMS> keys{};
+      for(std::size_t i = 0; i < nb_algos_; ++i) keys[i] = algos_[i].key_at(begin_pos);
+
+      std::array<std::uint8_t, details::DECODE_CHUNK_SIZE> chunk;
+      while(begin < end) {
+        const auto size = std::min(static_cast<std::size_t>(end - begin), details::DECODE_CHUNK_SIZE);
+        std::copy_n(begin, size, chunk.begin());
+        for(std::size_t i = nb_algos_; i-- > 0;)
+          keys[i] = algos_[i].decode_block(chunk.data(), size, keys[i]);
+        std::copy_n(chunk.begin(), size, begin);
+        begin += size;
+      }
     }
 
+    /// Get the number of active (i.e. not identity) obfuscations.
+    [[nodiscard]] constexpr std::size_t size() const noexcept { return nb_algos_; }
+
     /// Get a decoded element.
     /// \param index Position of the element to decode and return.
     constexpr Obfuscation &operator[](std::size_t index) noexcept { return algos_[index]; }
@@ -339,8 +663,21 @@ namespace andrivet::advobfuscator {
     /// \param index Position of the element to decode and return.
     constexpr const Obfuscation &operator[](std::size_t index) const noexcept { return algos_[index]; }
 
-    /// A set of obfuscations
+    /// A set of obfuscations. The active ones come first, the others are identities.
     std::array<Obfuscation, details::MAX_NB_ALGORITHMS> algos_;
+    /// Number of active obfuscations.
+    std::size_t nb_algos_ = 0;
+
+  private:
+    /// Drop the identity obfuscations (they do not change the data) and move the active ones first, in order.
+    consteval void compact() noexcept {
+      for(std::size_t i = 0; i < details::MAX_NB_ALGORITHMS; ++i) {
+        if(algos_[i].data_algo() == DataAlgorithm::IDENTITY) continue;
+        algos_[nb_algos_++] = algos_[i];
+      }
+      for(std::size_t i = nb_algos_; i < details::MAX_NB_ALGORITHMS; ++i)
+        algos_[i] = details::make_algorithm();
+    }
   };
 }
 
@@ -0,0 +1,63 @@
+// ADVobfuscator - Output of decoded strings by small chunks
+//
+// Copyright (c) 2025, Sebastien Andrivet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+// following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+// disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+// following disclaimer in the documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+// products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+// USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Get latest version on https://github.com/andrivet/ADVobfuscator
+
+#ifndef ADVOBFUSCATOR_OUTPUT_H
+#define ADVOBFUSCATOR_OUTPUT_H
+
+#include <cstddef>
+#include <algorithm>
+#include <ostream>
+#include <string_view>
+
+namespace andrivet::advobfuscator::details {
+  /// Number of characters decoded at once when they are sent to an output (stream, formatter)
+  static const std::size_t OUTPUT_CHUNK_SIZE = 64;
+
+  /// Write characters produced by chunks to an output stream.
+  /// \param os The output stream.
+  /// \param size The total number of characters.
+  /// \param chunks Callable object producing (up to a size) the chunks of characters and sending them to a sink.
+  /// \remark The width, fill and adjustment of the stream are honored, like for any other string.
+  template<typename Chunks>
+  std::ostream &write_chunks(std::ostream &os, std::size_t size, Chunks &&chunks) {
+    const std::ostream::sentry sentry{os};
+    if(!sentry) return os;
+
+    const auto width = static_cast<std::size_t>(std::max<std::streamsize>(os.width(), 0));
+    const auto padding = width > size ? width - size : 0;
+    const bool left = (os.flags() & std::ios_base::adjustfield) == std::ios_base::left;
+    const auto pad = [&] { for(std::size_t i = 0; i < padding; ++i) os.put(os.fill()); };
+
+    if(!left) pad();
+    chunks([&](std::string_view chunk) { os.write(chunk.data(), static_cast<std::streamsize>(chunk.size())); }, size);
+    if(left) pad();
+    os.width(0);
+    return os;
+  }
+}
+
+#endif
@@ -25,7 +25,9 @@
 //
 // Get latest version on https://github.com/andrivet/ADVobfuscator
 
+#include <cstddef>
 #include <cstdint>
+#include <array>
 
 #ifndef ADVOBFUSCATOR_RANDOM_H
 #define ADVOBFUSCATOR_RANDOM_H
@@ -127,6 +129,17 @@ namespace andrivet::advobfuscator {
     return sum;
   }
 
+  /// Compute the sum of a initial number of of the values of bytes.
+  /// \tparam N The number of bytes.
+  /// \param bytes The array of bytes.
+  /// \param initial The initial value of the sum (0 by default).
+  template<std::size_t N>
+  consteval std::size_t generate_sum(const std::array<std::uint8_t, N> &bytes, size_t initial = 0) {
+    std::size_t sum = initial;
+    for(std::size_t i = 0; i < N; ++i) sum = (sum + bytes[i]) % 1000;
+    return sum;
+  }
+
 }
 
 #endif
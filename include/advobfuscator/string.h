@@ -28,17 +28,23 @@
 #ifndef ADVOBFUSCATOR_STRING_H
 #define ADVOBFUSCATOR_STRING_H
 
+#include <algorithm>
+#include <span>
 #include <string>
 
 #include "aes_string.h"
 #include "obf.h"
 #include "call.h"
+#include "fixed_string.h"
+#include "output.h"
+#include "view.h"
 
 namespace andrivet::advobfuscator {
 
   /// An obfuscated string of characters.
   /// \tparam N The number of bytes of the string (including the null terminal byte).
-  template<std::size_t N>
+  /// \tparam C Conversion to a pointer to characters, once the string is decoded.
+  template<std::size_t N, Conversion C = Conversion::OBFUSCATED>
   struct ObfuscatedString {
     /// Construct an obfuscated string of characters.
     /// \param str The array of characters (including the null terminal byte).
@@ -71,8 +77,7 @@ namespace andrivet::advobfuscator {
     /// Implicit conversion to a pointer to (const) characters, like a regular string.
     operator const char* () noexcept {
       constexpr auto random = call::generate_random(__LINE__);
-      const ObfuscatedMethodCall call{random, &ObfuscatedString::decode_inplace};
-      call(random, this);
+      obfuscated_conversion<C, random, &ObfuscatedString::decode_inplace>(this, !obfuscated_);
       return data_.data();
     }
 
@@ -80,19 +85,108 @@ namespace andrivet::advobfuscator {
     [[nodiscard]] const char *raw() const noexcept { return data_.data(); }
 
     /// Get the actual length of the string.
-    [[nodiscard]] constexpr std::size_t size() noexcept { return N - 1; }
+    [[nodiscard]] constexpr std::size_t size() const noexcept { return N - 1; }
+
+    /// Decode the obfuscated string by small chunks and send them to a sink.
+    /// \param sink Callable object receiving each chunk of decoded characters as a std::string_view.
+    /// \param size Maximal number of characters to decode (the whole string by default).
+    /// \remark Only a small buffer on the stack is used and it is erased after use.
+    template<typename Sink>
+    constexpr void decode_chunks(Sink &&sink, std::size_t size = N - 1) const {
+      std::array<char, details::OUTPUT_CHUNK_SIZE> chunk;
+      size = std::min(size, N - 1);
+      for(std::size_t pos = 0; pos < size; pos += chunk.size()) {
+        const auto nb_chars = decode_range(pos, std::min(size - pos, chunk.size()), chunk.data());
+        sink(std::string_view{chunk.data(), nb_chars});
+      }
+      std::fill(chunk.begin(), chunk.end(), 0);
+    }
+
+    /// Decoder of the characters of a string, one at a time.
+    struct Cursor {
+      /// Decode a character.
+      /// \param pos Position of the character in the string.
+      constexpr char operator()(std::size_t pos) const noexcept {
+        char c{};
+        string->decode_range(pos, 1, &c);
+        return c;
+      }
+
+      /// The obfuscated string.
+      const ObfuscatedString *string = nullptr;
+    };
+
+    /// Get a view of the characters (without the terminal null byte), decoded when they are accessed.
+    /// \remark The view refers to this string.
+    [[nodiscard]] constexpr DecodedView<Cursor> view() const & noexcept { return {Cursor{this}, N - 1}; }
+    /// A view of a temporary string would dangle.
+    void view() const && = delete;
 
     /// Decode the obfuscated string
     [[nodiscard]] constexpr std::string decode() const {
-      std::array<std::uint8_t, N> buffer;
-      std::copy(data_.begin(), data_.end(), buffer.begin());
-      if(obfuscated_) algos_.decode(0, buffer.begin(), buffer.end());
       std::string str;
-      str.resize(N - 1);
-      std::copy(buffer.begin(), buffer.end() - 1, str.begin());
+      decode_to(str);
+      return str;
+    }
+
+    /// Decode the obfuscated string without any heap allocation.
+    /// \return The decoded string, stored in place.
+    [[nodiscard]] constexpr FixedString<N> decode_fixed() const noexcept {
+      FixedString<N> str;
+      str.size_ = decode(0, N - 1, str.data_.data());
       return str;
     }
 
+    /// Decode the obfuscated string into a buffer.
+    /// \param out The buffer. If there is enough room, the string is terminated by a null byte.
+    /// \return The number of characters decoded (without the null byte).
+    constexpr std::size_t decode_to(std::span<char> out) const noexcept {
+      const auto size = decode(0, out.size(), out.data());
+      if(size < out.size()) out[size] = '\0';
+      return size;
+    }
+
+    /// Decode the obfuscated string into a string of characters, reusing its memory if possible.
+    /// \param str The string receiving the decoded characters.
+    constexpr void decode_to(std::string &str) const {
+#if defined(__cpp_lib_string_resize_and_overwrite)
+      str.resize_and_overwrite(N - 1, [this](char *out, std::size_t size) { return decode(0, size, out); });
+#else
+      str.resize(N - 1);
+      decode(0, N - 1, str.data());
+#endif
+    }
+
+    /// Decode a part of the string.
+    /// \param pos Position of the first character to decode.
+    /// \param len Number of characters to decode.
+    /// \param out Buffer receiving the decoded characters. It has to be large enough for len characters.
+    /// \return The number of characters decoded. It is less than len if the end of the string is reached.
+    /// \remark The terminal null byte is not part of the characters.
+    constexpr std::size_t decode(std::size_t pos, std::size_t len, char *out) const noexcept {
+      return decode_range(pos, std::min(len, N - 1 - std::min(pos, N - 1)), out);
+    }
+
+    /// Decode a part of the string until a null character is found.
+    /// \param pos Position of the first character to decode.
+    /// \param len Maximal number of characters to decode, including the null character.
+    /// \param out Buffer receiving the decoded characters. It has to be large enough for len characters.
+    /// \return The number of characters decoded before the null character (like strlen), or the number of characters
+    /// decoded if no null character was found.
+    /// \remark The decoding is done by chunks and stops after the chunk containing the null character.
+    /// If there is enough room, the string is always terminated by its terminal null byte.
+    constexpr std::size_t decode_prefix(std::size_t pos, std::size_t len, char *out) const noexcept {
+      len = std::min(len, N - std::min(pos, N));
+      std::size_t done = 0;
+      while(done < len) {
+        const auto size = decode_range(pos + done, std::min(len - done, details::DECODE_CHUNK_SIZE), out + done);
+        const auto nul = std::find(out + done, out + done + size, '\0');
+        if(nul != out + done + size) return static_cast<std::size_t>(nul - out);
+        done += size;
+      }
+      return done;
+    }
+
     /// Encoded or decoded data.
     std::array<char, N> data_{};
     /// Obfuscations used to encode the data.
@@ -101,6 +195,16 @@ namespace andrivet::advobfuscator {
     bool obfuscated_ = true;
 
   private:
+    /// Decode a range of bytes (including the terminal null byte).
+    /// \param pos Position of the first byte to decode. It has to be in the string.
+    /// \param len Number of bytes to decode. The range has to be in the string.
+    /// \param out Buffer receiving the decoded bytes.
+    constexpr std::size_t decode_range(std::size_t pos, std::size_t len, char *out) const noexcept {
+      std::copy_n(data_.begin() + pos, len, out);
+      if(obfuscated_) algos_.decode(pos, out, out + len);
+      return len;
+    }
+
     /// Erase the data of the string.
     constexpr void erase() noexcept {
       if(!obfuscated_)
@@ -127,10 +231,21 @@ namespace andrivet::advobfuscator {
     }
   };
 
+  /// Write an obfuscated string to an output stream, without decoding it in-place.
+  /// \remark The string is decoded by small chunks. The width, fill and adjustment of the stream are honored.
+  template<std::size_t N, Conversion C>
+  std::ostream &operator<<(std::ostream &os, const ObfuscatedString<N, C> &str) {
+    return details::write_chunks(os, str.size(), [&](auto &&sink, std::size_t size) { str.decode_chunks(sink, size); });
+  }
+
   /// User-defined literal "_obf"
   template<ObfuscatedString str>
   consteval auto operator ""_obf() { return str; }
 
+  /// User-defined literal "_obf_fast" (conversions of the decoded string skip the obfuscated call)
+  template<details::Literal str>
+  consteval auto operator ""_obf_fast() { return ObfuscatedString<sizeof(str.chars), Conversion::FAST>{str.chars}; }
+
 }
 
 #endif
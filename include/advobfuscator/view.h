@@ -0,0 +1,113 @@
+// ADVobfuscator - Views decoding obfuscated data on the fly
+//
+// Copyright (c) 2025, Sebastien Andrivet
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are permitted provided that the
+// following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following
+// disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the
+// following disclaimer in the documentation and/or other materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote
+// products derived from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES,
+// INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE
+// USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Get latest version on https://github.com/andrivet/ADVobfuscator
+
+#ifndef ADVOBFUSCATOR_VIEW_H
+#define ADVOBFUSCATOR_VIEW_H
+
+#include <cstddef>
+#include <compare>
+#include <iterator>
+#include <ranges>
+#include <type_traits>
+
+namespace andrivet::advobfuscator {
+
+  /// A view decoding the elements of obfuscated or encrypted data when they are accessed.
+  /// \tparam Cursor Callable object decoding the element at a given position.
+  /// \remark Nothing is decoded up front and nothing is stored, except what the cursor caches.
+  /// The view and its iterators refer to the data: they have to be used while the data is alive.
+  template<typename Cursor>
+  class DecodedView : public std::ranges::view_interface<DecodedView<Cursor>> {
+  public:
+    /// Type of the decoded elements.
+    using value_type = std::remove_cvref_t<std::invoke_result_t<const Cursor &, std::size_t>>;
+
+    /// Random-access iterator decoding an element when it is dereferenced.
+    class iterator {
+    public:
+      using iterator_concept = std::random_access_iterator_tag;
+      using iterator_category = std::input_iterator_tag;
+      using value_type = DecodedView::value_type;
+      using difference_type = std::ptrdiff_t;
+
+      constexpr iterator() = default;
+      constexpr iterator(const Cursor &cursor, std::size_t pos) : cursor_{cursor}, pos_{pos} {}
+
+      /// Decode the current element.
+      constexpr value_type operator*() const { return cursor_(pos_); }
+      /// Decode an element relatively to the current one.
+      constexpr value_type operator[](difference_type n) const { return cursor_(pos_ + n); }
+
+      constexpr iterator &operator++() { ++pos_; return *this; }
+      constexpr iterator operator++(int) { auto it = *this; ++pos_; return it; }
+      constexpr iterator &operator--() { --pos_; return *this; }
+      constexpr iterator operator--(int) { auto it = *this; --pos_; return it; }
+      constexpr iterator &operator+=(difference_type n) { pos_ += n; return *this; }
+      constexpr iterator &operator-=(difference_type n) { pos_ -= n; return *this; }
+
+      friend constexpr iterator operator+(iterator it, difference_type n) { return it += n; }
+      friend constexpr iterator operator+(difference_type n, iterator it) { return it += n; }
+      friend constexpr iterator operator-(iterator it, difference_type n) { return it -= n; }
+      friend constexpr difference_type operator-(const iterator &a, const iterator &b) {
+        return static_cast<difference_type>(a.pos_) - static_cast<difference_type>(b.pos_);
+      }
+      friend constexpr bool operator==(const iterator &a, const iterator &b) { return a.pos_ == b.pos_; }
+      friend constexpr auto operator<=>(const iterator &a, const iterator &b) { return a.pos_ <=> b.pos_; }
+
+    private:
+      /// Decoder of the elements.
+      Cursor cursor_{};
+      /// Position of the current element.
+      std::size_t pos_ = 0;
+    };
+
+    constexpr DecodedView() = default;
+
+    /// Construct a view.
+    /// \param cursor Callable object decoding the element at a given position.
+    /// \param size Number of elements.
+    constexpr DecodedView(const Cursor &cursor, std::size_t size) : cursor_{cursor}, size_{size} {}
+
+    [[nodiscard]] constexpr iterator begin() const { return iterator{cursor_, 0}; }
+    [[nodiscard]] constexpr iterator end() const { return iterator{cursor_, size_}; }
+    [[nodiscard]] constexpr std::size_t size() const noexcept { return size_; }
+
+  private:
+    /// Decoder of the elements.
+    Cursor cursor_{};
+    /// Number of elements.
+    std::size_t size_ = 0;
+  };
+}
+
+namespace std::ranges {
+  /// Iterators do not depend on the view itself, only on the data.
+  template<typename Cursor>
+  inline constexpr bool enable_borrowed_range<andrivet::advobfuscator::DecodedView<Cursor>> = true;
+}
+
+#endif
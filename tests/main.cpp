@@ -26,13 +26,47 @@
 // Get latest version on https://github.com/andrivet/ADVobfuscator
 
 #include <cassert>
+#include <algorithm>
+#include <execution>
+#include <iomanip>
+#include <ranges>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <advobfuscator/string.h>
 #include <advobfuscator/bytes.h>
 #include <advobfuscator/aes.h>
 #include <advobfuscator/aes_string.h>
+#include <advobfuscator/aes_parallel.h>
+#include <advobfuscator/aes_reader.h>
+#include <advobfuscator/aes_string_table.h>
+#include <advobfuscator/chacha_string.h>
 
 using namespace andrivet::advobfuscator;
 
+// AES-128 key of the examples of FIPS-197 (appendices A and B) and NIST SP 800-38A
+static constexpr Key fips_key = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+// Nonce of the tests of the CTR mode
+static constexpr Nonce ctr_nonce = {0xb2, 0x96, 0x75, 0x8f, 0x1b, 0x06, 0x5d, 0x3e};
+
+// Run a check, templated by the implementation of the cipher, for each AES backend
+template<typename Check>
+void for_each_aes_backend(const Check &check) {
+  check.template operator()<AesBackend::REFERENCE>();
+  check.template operator()<AesBackend::TTABLE>();
+  check.template operator()<AesBackend::BITSLICED>();
+  check.template operator()<AesBackend::AESNI>();
+}
+
+// Run a check, templated by the implementation of the cipher, for each ChaCha20 backend
+template<typename Check>
+void for_each_chacha_backend(const Check &check) {
+  check.template operator()<ChaChaBackend::PORTABLE>();
+  check.template operator()<ChaChaBackend::SSE2>();
+  check.template operator()<ChaChaBackend::AVX2>();
+}
+
 void test_strings_obfuscation() {
   auto s0 = "abc"_obf;
 
@@ -147,6 +181,17 @@ void test_strings_obfuscation() {
 
   static constexpr auto s5 = "An immutable compile-time string"_obf;
   assert(s5.decode() == "An immutable compile-time string");
+
+  // Identity layers are dropped, the other ones are kept in order
+  static constexpr Parameters params6[] = {
+      {.key=1, .key_algo=KeyAlgorithm::IDENTITY, .data_algo=DataAlgorithm::XOR},
+      {.key=7, .key_algo=KeyAlgorithm::INCREMENT, .data_algo=DataAlgorithm::IDENTITY},
+      {.key=3, .key_algo=KeyAlgorithm::SWAP, .data_algo=DataAlgorithm::CAESAR}
+  };
+  static constexpr auto s6 = ObfuscatedString("Fused layers", params6);
+  assert(s6.algos_.size() == 2);
+  assert(s6.algos_[1].data_algo() == DataAlgorithm::CAESAR);
+  assert(s6.decode() == "Fused layers");
 }
 
 void test_block_obfuscation() {
@@ -190,13 +235,208 @@ void test_block_obfuscation() {
 
 }
 
+void test_key_schedule() {
+  static constexpr Obfuscation algos[] = {
+    Obfuscation{{.key=0x5A, .key_algo=KeyAlgorithm::IDENTITY, .data_algo=DataAlgorithm::XOR}},
+    Obfuscation{{.key=0xF3, .key_algo=KeyAlgorithm::INCREMENT, .data_algo=DataAlgorithm::CAESAR}},
+    Obfuscation{{.key=0x3C, .key_algo=KeyAlgorithm::INVERT, .data_algo=DataAlgorithm::ROTATE}},
+    Obfuscation{{.key=0x71, .key_algo=KeyAlgorithm::SUBSTITUTE, .data_algo=DataAlgorithm::SUBSTITUTE}},
+    Obfuscation{{.key=0x1E, .key_algo=KeyAlgorithm::SWAP, .data_algo=DataAlgorithm::XOR}}
+  };
+
+  // Seeking to a position has to give the same key as walking the key schedule
+  for(const auto &algo : algos) {
+    auto key = algo.key();
+    for(std::size_t pos = 0; pos < 600; ++pos, key = algo.next_key(key))
+      assert(algo.key_at(pos) == key);
+  }
+
+  // Random access has to give the same bytes as decoding the whole block
+  static constexpr auto block = "00 11 22 33 44 55 66 77 88 99 AA BB CC DD EE FF 01 23 45 67 89 AB CD EF"_obf_bytes;
+  const auto decoded = block.decode();
+  for(std::size_t i = 0; i < block.size(); ++i)
+    assert(block[i] == decoded[i]);
+}
+
+template<DataAlgorithm D, KeyAlgorithm K, std::uint8_t Key>
+void test_simd_decode() {
+  static constexpr Obfuscation algo{{.key=Key, .key_algo=K, .data_algo=D}};
+
+  std::array<std::uint8_t, 300> input;
+  for(std::size_t i = 0; i < input.size(); ++i) input[i] = static_cast<std::uint8_t>(i * 37 + 11);
+
+  for(std::size_t begin_pos: {0, 1, 5, 200}) {
+    for(std::size_t size: {0, 1, 15, 16, 17, 31, 32, 33, 64, 100, 255, 300}) {
+      auto expected = input;
+      algo.decode(begin_pos, expected.begin(), expected.begin() + size);
+
+      auto decoded = input;
+      const auto key = details::decode_block<D, K>(decoded.data(), size, algo.key_at(begin_pos));
+      assert(decoded == expected);
+      assert(key == algo.key_at(begin_pos + size));
+
+#if defined(ADVOBFUSCATOR_X86_64)
+      decoded = input;
+      auto done = details::sse2::decode_block<D, K>(decoded.data(), size, algo.key_at(begin_pos));
+      assert(done == size - size % 16);
+      assert(std::equal(decoded.begin(), decoded.begin() + done, expected.begin()));
+
+      if(cpu::has_avx2()) {
+        decoded = input;
+        done = details::avx2::decode_block<D, K>(decoded.data(), size, algo.key_at(begin_pos));
+        assert(done == size - size % 32);
+        assert(std::equal(decoded.begin(), decoded.begin() + done, expected.begin()));
+      }
+#endif
+    }
+  }
+}
+
+template<DataAlgorithm D>
+void test_simd_decode() {
+  using enum KeyAlgorithm;
+  test_simd_decode<D, IDENTITY, 0x00>(); test_simd_decode<D, IDENTITY, 0x93>();
+  test_simd_decode<D, INCREMENT, 0x01>(); test_simd_decode<D, INCREMENT, 0xF7>();
+  test_simd_decode<D, INVERT, 0x35>(); test_simd_decode<D, INVERT, 0xC2>();
+  test_simd_decode<D, SUBSTITUTE, 0x6B>(); test_simd_decode<D, SUBSTITUTE, 0x80>();
+  test_simd_decode<D, SWAP, 0x1F>(); test_simd_decode<D, SWAP, 0xEE>();
+}
+
+void test_simd_decode() {
+  using enum DataAlgorithm;
+  test_simd_decode<CAESAR>();
+  test_simd_decode<XOR>();
+  test_simd_decode<ROTATE>();
+  test_simd_decode<SUBSTITUTE>();
+
+  // Large literal
+  static constexpr auto s = "-----BEGIN CERTIFICATE-----\n"
+    "MIICUTCCAfugAwIBAgIBADANBgkqhkiG9w0BAQQFADBXMQswCQYDVQQGEwJDTjEL\n"
+    "MAkGA1UECBMCUE4xCzAJBgNVBAcTAkNOMQswCQYDVQQKEwJPTjELMAkGA1UECxMC\n"
+    "VU4xFDASBgNVBAMTC0hlcm9uZyBZYW5nMB4XDTA1MDcxNTIxMTk0N1oXDTA1MDgx\n"
+    "NDIxMTk0N1owVzELMAkGA1UEBhMCQ04xCzAJBgNVBAgTAlBOMQswCQYDVQQHEwJD\n"
+    "TjELMAkGA1UEChMCT04xCzAJBgNVBAsTAlVOMRQwEgYDVQQDEwtIZXJvbmcgWWFu\n"
+    "-----END CERTIFICATE-----"_obf;
+  assert(s.decode() == "-----BEGIN CERTIFICATE-----\n"
+    "MIICUTCCAfugAwIBAgIBADANBgkqhkiG9w0BAQQFADBXMQswCQYDVQQGEwJDTjEL\n"
+    "MAkGA1UECBMCUE4xCzAJBgNVBAcTAkNOMQswCQYDVQQKEwJPTjELMAkGA1UECxMC\n"
+    "VU4xFDASBgNVBAMTC0hlcm9uZyBZYW5nMB4XDTA1MDcxNTIxMTk0N1oXDTA1MDgx\n"
+    "NDIxMTk0N1owVzELMAkGA1UEBhMCQ04xCzAJBgNVBAgTAlBOMQswCQYDVQQHEwJD\n"
+    "TjELMAkGA1UEChMCT04xCzAJBgNVBAsTAlVOMRQwEgYDVQQDEwtIZXJvbmcgWWFu\n"
+    "-----END CERTIFICATE-----");
+}
+
+void test_partial_decode() {
+  static constexpr auto s = "Header: value\0Body"_obf;
+  char buffer[32]{};
+
+  assert(s.decode(0, 6, buffer) == 6);
+  assert(std::string_view(buffer, 6) == "Header");
+  assert(s.decode(8, 5, buffer) == 5);
+  assert(std::string_view(buffer, 5) == "value");
+  assert(s.decode(14, 100, buffer) == 4);
+  assert(std::string_view(buffer, 4) == "Body");
+  assert(s.decode(100, 4, buffer) == 0);
+
+  assert(s.decode_prefix(0, sizeof(buffer), buffer) == 13);
+  assert(std::string_view(buffer) == "Header: value");
+  assert(s.decode_prefix(14, sizeof(buffer), buffer) == 4);
+  assert(std::string_view(buffer) == "Body");
+  assert(s.decode_prefix(0, 3, buffer) == 3);
+
+  static constexpr auto block = "10 20 30 00 40 50"_obf_bytes;
+  std::uint8_t bytes[8]{};
+  assert(block.decode(1, 2, bytes) == 2);
+  assert(bytes[0] == 0x20 && bytes[1] == 0x30);
+  assert(block.decode(4, 10, bytes) == 2);
+  assert(bytes[0] == 0x40 && bytes[1] == 0x50);
+  assert(block.decode_prefix(0, sizeof(bytes), bytes) == 3);
+  assert(bytes[0] == 0x10 && bytes[2] == 0x30 && bytes[3] == 0x00);
+}
+
+void test_views() {
+  static constexpr auto s = "Hello, world"_obf;
+  const auto view = s.view();
+  static_assert(std::ranges::random_access_range<decltype(view)>);
+  static_assert(std::ranges::view<std::remove_const_t<decltype(view)>>);
+  assert(std::ranges::equal(view, std::string_view{"Hello, world"}));
+  assert(std::ranges::find(view, ',') - view.begin() == 5);
+
+  std::string hello;
+  std::ranges::copy(view | std::views::take_while([](char c) { return c != ','; }), std::back_inserter(hello));
+  assert(hello == "Hello");
+
+  static constexpr auto block = "DE AD BE EF"_obf_bytes;
+  static constexpr std::uint8_t expected[] = {0xDE, 0xAD, 0xBE, 0xEF};
+  assert(std::ranges::equal(block.view(), expected));
+  assert(block.view()[2] == 0xBE);
+
+  static constexpr auto a = "A string longer than one block of AES"_aes;
+  assert(std::ranges::equal(a.view(), std::string_view{"A string longer than one block of AES"}));
+  assert(*std::ranges::find(a.view(), 'b') == 'b');
+  assert(a.view().end()[-1] == 'S');
+}
+
+void test_decode_without_allocation() {
+  static constexpr auto s = "Decoded in place"_obf;
+  const auto fixed = s.decode_fixed();
+  assert(fixed == "Decoded in place");
+  assert(fixed.size() == 16);
+  assert(fixed.c_str()[16] == '\0');
+
+  char buffer[32];
+  assert(s.decode_to(buffer) == 16);
+  assert(std::string_view{buffer} == "Decoded in place");
+  char small[7];
+  assert(s.decode_to(small) == 7);
+  assert(std::string_view(small, 7) == "Decoded");
+
+  std::string str = "previous content that is longer";
+  s.decode_to(str);
+  assert(str == "Decoded in place");
+
+  static constexpr auto a = "Decrypted in place, longer than a block"_aes;
+  assert(a.decrypt_fixed() == "Decrypted in place, longer than a block");
+  char aes_buffer[64];
+  assert(a.decrypt_to(aes_buffer) == 39);
+  assert(std::string_view{aes_buffer} == "Decrypted in place, longer than a block");
+  a.decrypt_to(str);
+  assert(str == "Decrypted in place, longer than a block");
+  assert(a.decrypt() == "Decrypted in place, longer than a block");
+}
+
+void test_output_by_chunks() {
+  static constexpr auto s = "A string long enough to be decoded in more than one chunk when it is sent to an output stream"_obf;
+  std::string chunks;
+  std::size_t nb_chunks = 0;
+  s.decode_chunks([&](std::string_view chunk) { chunks += chunk; ++nb_chunks; });
+  assert(chunks == s.decode());
+  assert(nb_chunks == 2);
+
+  std::ostringstream os;
+  os << s;
+  assert(os.str() == s.decode());
+
+  static constexpr auto short_str = "abc"_obf;
+  os.str("");
+  os << std::setw(6) << std::setfill('*') << short_str << '|' << std::left << std::setw(5) << short_str << '|' << short_str;
+  assert(os.str() == "***abc|abc**|abc");
+
+  static constexpr auto a = "An encrypted string long enough to be decrypted in more than one chunk by an output stream"_aes;
+  chunks.clear();
+  a.decrypt_chunks([&](std::string_view chunk) { chunks += chunk; }, 70);
+  assert(chunks == a.decrypt().substr(0, 70));
+
+  os.str("");
+  os << a;
+  assert(os.str() == a.decrypt());
+}
+
 void test_aes_key_expansion() {
   // https://csrc.nist.gov/files/pubs/fips/197/final/docs/fips-197.pdf
   // Appendix A - Key Expansion Examples
 
-  static constexpr Key key = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
-
-  const auto expanded = details::key_expansion(key);
+  const auto expanded = details::key_expansion(fips_key);
 
   uint32_t w00 = expanded[ 0][0] << 24 | expanded[ 0][1] << 16 | expanded[ 0][2] << 8 | expanded[ 0][3];
   uint32_t w01 = expanded[ 1][0] << 24 | expanded[ 1][1] << 16 | expanded[ 1][2] << 8 | expanded[ 1][3];
@@ -304,15 +544,14 @@ void test_aes_cipher() {
   // Appendix B - Cipher Example
 
   static constexpr Block input = {0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d, 0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34};
-  static constexpr Key key = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
 
-  const auto encrypted = encrypt(input, key);
+  const auto encrypted = encrypt(input, fips_key);
   assert(encrypted[ 0] == 0x39); assert(encrypted[ 1] == 0x25); assert(encrypted[ 2] == 0x84); assert(encrypted[ 3] == 0x1d);
   assert(encrypted[ 4] == 0x02); assert(encrypted[ 5] == 0xdc); assert(encrypted[ 6] == 0x09); assert(encrypted[ 7] == 0xfb);
   assert(encrypted[ 8] == 0xdc); assert(encrypted[ 9] == 0x11); assert(encrypted[10] == 0x85); assert(encrypted[11] == 0x97);
   assert(encrypted[12] == 0x19); assert(encrypted[13] == 0x6a); assert(encrypted[14] == 0x0b); assert(encrypted[15] == 0x32);
 
-  const auto decrypted = decrypt(encrypted, key);
+  const auto decrypted = decrypt(encrypted, fips_key);
   assert(decrypted[ 0] == 0x32); assert(decrypted[ 1] == 0x43); assert(decrypted[ 2] == 0xf6); assert(decrypted[ 3] == 0xa8);
   assert(decrypted[ 4] == 0x88); assert(decrypted[ 5] == 0x5a); assert(decrypted[ 6] == 0x30); assert(decrypted[ 7] == 0x8d);
   assert(decrypted[ 8] == 0x31); assert(decrypted[ 9] == 0x31); assert(decrypted[10] == 0x98); assert(decrypted[11] == 0xa2);
@@ -321,11 +560,9 @@ void test_aes_cipher() {
 
 void test_aes_ctr_cipher() {
   static constexpr Byte input[] = {0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d, 0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34, 0x69, 0x65, 0xfa, 0x98, 0x18, 0xad, 0x58};
-  static constexpr Key key = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6, 0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
-  static constexpr Nonce nonce = {0xb2, 0x96, 0x75, 0x8f, 0x1b, 0x06, 0x5d, 0x3e};
 
-  auto encrypted = encrypt_ctr(input, key, nonce);
-  decrypt_ctr(encrypted.data(), encrypted.size(), key, nonce);
+  auto encrypted = encrypt_ctr(input, fips_key, ctr_nonce);
+  decrypt_ctr(encrypted.data(), encrypted.size(), fips_key, ctr_nonce);
 
   auto decrypted = encrypted.data();
   assert(decrypted[ 0] == input[ 0]); assert(decrypted[ 1] == input[ 1]); assert(decrypted[ 2] == input[ 2]); assert(decrypted[ 3] == input[ 3]);
@@ -336,12 +573,576 @@ void test_aes_ctr_cipher() {
   assert(decrypted[20] == input[20]); assert(decrypted[21] == input[21]); assert(decrypted[22] == input[22]);
 }
 
+void test_aes_context() {
+  static constexpr Block input = {0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d, 0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34};
+
+  // The same expanded key is used for several blocks
+  const AesContext context{fips_key};
+  assert(context.ekey() == details::key_expansion(fips_key));
+  const auto encrypted = encrypt(input, context);
+  assert(encrypted == encrypt(input, fips_key));
+  assert(decrypt(encrypted, context) == input);
+
+  // Also at compile-time
+  static_assert(encrypt(Block{}, AesContext{Key{}}) == encrypt(Block{}, Key{}));
+
+  static constexpr Byte plain[] = "A plain text longer than several blocks of AES (128-bit)";
+  auto data = encrypt_ctr(plain, fips_key, ctr_nonce);
+  decrypt_ctr(data.data(), 20, context, ctr_nonce);
+  decrypt_ctr(data.data() + 20, data.size() - 20, context, ctr_nonce, 20);
+  assert(std::equal(data.begin(), data.end(), std::begin(plain)));
+}
+
+void test_aes_backends() {
+  // https://csrc.nist.gov/files/pubs/fips/197/final/docs/fips-197.pdf
+  // Appendix B - Cipher Example
+  static constexpr Block input = {0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d, 0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34};
+  static constexpr Block output = {0x39, 0x25, 0x84, 0x1d, 0x02, 0xdc, 0x09, 0xfb, 0xdc, 0x11, 0x85, 0x97, 0x19, 0x6a, 0x0b, 0x32};
+
+  const AesContext context{fips_key};
+  assert(encrypt<AesBackend::REFERENCE>(input, context) == output);
+  assert(encrypt<AesBackend::TTABLE>(input, context) == output);
+  assert(decrypt<AesBackend::REFERENCE>(output, context) == input);
+  assert(decrypt<AesBackend::TTABLE>(output, context) == input);
+  static_assert(encrypt<AesBackend::TTABLE>(input, fips_key) == output);
+
+  // Each backend decrypts what the other one encrypts
+  static constexpr Byte plain[] = "A plain text longer than several blocks of AES (128-bit)";
+  auto data = encrypt_ctr<AesBackend::REFERENCE>(plain, fips_key, ctr_nonce);
+  decrypt_ctr<AesBackend::TTABLE>(data.data(), data.size(), context, ctr_nonce);
+  assert(std::equal(data.begin(), data.end(), std::begin(plain)));
+  data = encrypt_ctr<AesBackend::TTABLE>(plain, fips_key, ctr_nonce);
+  decrypt_ctr<AesBackend::REFERENCE>(data.data(), data.size(), context, ctr_nonce);
+  assert(std::equal(data.begin(), data.end(), std::begin(plain)));
+
+  Block block = input;
+  for(int i = 0; i < 16; ++i) {
+    const auto next = encrypt<AesBackend::REFERENCE>(block, context);
+    assert(next == encrypt<AesBackend::TTABLE>(block, context));
+    assert(decrypt<AesBackend::TTABLE>(next, context) == block);
+    block = next;
+  }
+}
+
+void test_aes_ni() {
+  static constexpr Byte plain[] =
+    "A plain text long enough to be decrypted by groups of counter blocks with the AES instructions, "
+    "then block by block, and finally with a partial block at the end. It has to be longer than 256 bytes.";
+  static constexpr auto encrypted = encrypt_ctr(plain, fips_key, ctr_nonce);
+
+  const AesContext context{fips_key};
+  // Several ranges, starting or not at the beginning of a block
+  for(std::size_t offset: {0, 1, 15, 16, 17, 33, 100}) {
+    for(std::size_t size: {0, 1, 16, 31, 128, 150, 200}) {
+      if(offset + size > encrypted.size()) continue;
+      auto aesni = encrypted;
+      decrypt_ctr<AesBackend::AESNI>(aesni.data() + offset, size, context, ctr_nonce, offset);
+      auto ttable = encrypted;
+      decrypt_ctr<AesBackend::TTABLE>(ttable.data() + offset, size, context, ctr_nonce, offset);
+      assert(aesni == ttable);
+      assert(std::equal(aesni.begin() + offset, aesni.begin() + offset + size, std::begin(plain) + offset));
+    }
+  }
+}
+
+void test_aes_bitsliced() {
+  // The S-Box circuit gives the same result as the table, for each byte
+  const details::SBox sbox{details::sbox};
+  for(std::size_t x = 0; x < 256; x += 4) {
+    const details::Word w{Byte(x), Byte(x + 1), Byte(x + 2), Byte(x + 3)};
+    assert(details::bitsliced::sub_word(w) == details::sub_word(w, sbox));
+  }
+
+  // https://csrc.nist.gov/files/pubs/fips/197/final/docs/fips-197.pdf
+  // Appendix B - Cipher Example
+  static constexpr Block input = {0x32, 0x43, 0xf6, 0xa8, 0x88, 0x5a, 0x30, 0x8d, 0x31, 0x31, 0x98, 0xa2, 0xe0, 0x37, 0x07, 0x34};
+  static constexpr Block output = {0x39, 0x25, 0x84, 0x1d, 0x02, 0xdc, 0x09, 0xfb, 0xdc, 0x11, 0x85, 0x97, 0x19, 0x6a, 0x0b, 0x32};
+
+  // The key schedule of a context is computed in constant-time
+  const AesContext context{fips_key};
+  assert(context.ekey() == details::key_expansion(fips_key));
+  assert(encrypt<AesBackend::BITSLICED>(input, context) == output);
+  assert(decrypt<AesBackend::BITSLICED>(output, context) == input);
+
+  static constexpr Byte plain[] =
+    "A plain text long enough to be decrypted by groups of four counter blocks, bit by bit and without tables.";
+  static constexpr auto encrypted = encrypt_ctr(plain, fips_key, ctr_nonce);
+  for(std::size_t offset: {0, 5, 16, 40}) {
+    auto data = encrypted;
+    decrypt_ctr<AesBackend::BITSLICED>(data.data() + offset, data.size() - offset, context, ctr_nonce, offset);
+    assert(std::equal(data.begin() + offset, data.end(), std::begin(plain) + offset));
+  }
+}
+
+template<typename Policy>
+void test_aes_policy(const typename Policy::Key &key, const Block &output) {
+  static constexpr Block input = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff};
+
+  const AesContext<Policy> context{key};
+  assert(context.ekey() == details::key_expansion<Policy>(key));
+  assert(encrypt<AesBackend::REFERENCE>(input, context) == output);
+  assert(encrypt<AesBackend::TTABLE>(input, context) == output);
+  assert(encrypt<AesBackend::BITSLICED>(input, context) == output);
+  assert(decrypt<AesBackend::REFERENCE>(output, context) == input);
+  assert(decrypt<AesBackend::TTABLE>(output, context) == input);
+  assert(decrypt<AesBackend::BITSLICED>(output, context) == input);
+
+  std::array<Byte, 200> data{};
+  for(std::size_t i = 0; i < data.size(); ++i) data[i] = static_cast<Byte>(i);
+  auto aesni = data, ttable = data, bitsliced = data;
+  decrypt_ctr<AesBackend::AESNI>(aesni.data(), aesni.size(), context, ctr_nonce);
+  decrypt_ctr<AesBackend::TTABLE>(ttable.data(), ttable.size(), context, ctr_nonce);
+  decrypt_ctr<AesBackend::BITSLICED>(bitsliced.data(), bitsliced.size(), context, ctr_nonce);
+  assert(aesni == ttable);
+  assert(bitsliced == ttable);
+}
+
+void test_aes_policies() {
+  // https://csrc.nist.gov/files/pubs/fips/197/final/docs/fips-197.pdf
+  // Appendix C - Example Vectors
+  test_aes_policy<Aes128>(
+    {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f},
+    {0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30, 0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a});
+  test_aes_policy<Aes192>(
+    {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+     0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17},
+    {0xdd, 0xa9, 0x7c, 0xa4, 0x86, 0x4c, 0xdf, 0xe0, 0x6e, 0xaf, 0x70, 0xa0, 0xec, 0x0d, 0x71, 0x91});
+  test_aes_policy<Aes256>(
+    {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+     0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f},
+    {0x8e, 0xa2, 0xb7, 0xca, 0x51, 0x67, 0x45, 0xbf, 0xea, 0xfc, 0x49, 0x90, 0x4b, 0x49, 0x60, 0x89});
+
+  // Reduced rounds: the first rounds are the same as AES-128
+  static constexpr AesLight::Key key{0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+  const AesContext<AesLight> light{key};
+  assert(std::equal(light.ekey().begin(), light.ekey().end(), details::key_expansion(key).begin()));
+  const Block block{1, 2, 3};
+  assert(decrypt(encrypt(block, light), light) == block);
+  assert(encrypt(block, light) != encrypt(block, AesContext{key}));
+
+  // A policy for each literal
+  static constexpr auto s192 = "A secret string encrypted with AES-192"_aes192;
+  static constexpr auto s256 = "A secret string encrypted with AES-256"_aes256;
+  static constexpr auto light_str = "A hot string encrypted with only 4 rounds"_aes_light;
+  static_assert(s256.ekey_.size() == 4 * (14 + 1));
+  // The key schedule is computed at compile-time and stored obfuscated
+  assert(s256.context().ekey() != s256.ekey_);
+  assert(s192.decrypt() == "A secret string encrypted with AES-192");
+  assert(s256.decrypt() == "A secret string encrypted with AES-256");
+  assert(light_str.decrypt() == "A hot string encrypted with only 4 rounds");
+  assert(std::ranges::equal(s256.view(), std::string_view{"A secret string encrypted with AES-256"}));
+}
+
+void test_aes_parallel() {
+  const AesContext context{fips_key};
+
+  // Several chunks, the last one is partial
+  std::vector<Byte> plain(3 * parallel_chunk_size + 21);
+  for(std::size_t i = 0; i < plain.size(); ++i) plain[i] = static_cast<Byte>(i * 7 + i / 256);
+  auto expected = plain;
+  decrypt_ctr(expected.data(), expected.size(), context, ctr_nonce);
+
+  auto data = plain;
+  decrypt_ctr_parallel(data.data(), data.size(), context, ctr_nonce, ThreadExecutor{3}, 0, 0);
+  assert(data == expected);
+
+  data = plain;
+  decrypt_ctr_parallel(data.data(), data.size(), context, ctr_nonce);
+  assert(data == expected);
+
+  // The chunks are aligned on the stream, not on the data
+  const std::size_t offset = parallel_chunk_size - 100;
+  std::size_t nb_tasks = 0;
+  const auto serial = [&](std::size_t n, auto &&task) {
+    nb_tasks = n;
+    for(std::size_t i = n; i > 0; --i) task(i - 1);
+  };
+  data = plain;
+  decrypt_ctr_parallel<AesBackend::TTABLE>(data.data() + offset, data.size() - offset, context, ctr_nonce, serial,
+                                           offset, 0);
+  assert(nb_tasks == 4);
+  assert(std::equal(data.begin() + offset, data.end(), expected.begin() + offset));
+
+  // Below the threshold, the executor is not used
+  nb_tasks = 0;
+  data = plain;
+  decrypt_ctr_parallel(data.data(), 1000, context, ctr_nonce, serial);
+  assert(nb_tasks == 0);
+  assert(std::equal(data.begin(), data.begin() + 1000, expected.begin()));
+
+  // An empty buffer is not split into tasks, even without threshold
+  decrypt_ctr_parallel(data.data(), 0, context, ctr_nonce, serial, 0, 0);
+  assert(nb_tasks == 0);
+
+  // Tasks run by a standard execution policy
+  data = plain;
+  decrypt_ctr_parallel(data.data(), data.size(), context, ctr_nonce, std::execution::seq, 0, 0);
+  assert(data == expected);
+  decrypt_ctr_parallel(data.data(), 0, context, ctr_nonce, std::execution::seq, 0, 0);
+  assert(data == expected);
+}
+
+void test_aes_reader() {
+  static constexpr Byte plain[] =
+    "A large resource embedded in the binary, encrypted as a whole and read by small windows at random positions.";
+  static constexpr auto encrypted = encrypt_ctr(plain, fips_key, ctr_nonce);
+
+  AesReader reader{encrypted, fips_key, ctr_nonce};
+  assert(reader.size() == sizeof(plain));
+
+  // Windows at any position, across blocks
+  for(std::size_t offset: {0, 1, 15, 16, 17, 40, 100}) {
+    std::array<Byte, 23> window{};
+    reader.seek(offset);
+    const auto size = reader.read(window);
+    assert(size == std::min(window.size(), sizeof(plain) - offset));
+    assert(std::equal(window.begin(), window.begin() + size, std::begin(plain) + offset));
+    assert(reader.tell() == offset + size);
+  }
+
+  // Sequential reads continue the stream
+  reader.seek(3);
+  char first[10]{}, second[10]{};
+  assert(reader.read(first) == 10 && reader.read(second) == 10);
+  assert(std::string_view(first, 10) == "arge resou");
+  assert(std::string_view(second, 10) == "rce embedd");
+
+  // End of the data
+  reader.seek(reader.size());
+  assert(reader.read(first) == 0);
+  bool thrown = false;
+  try { reader.seek(reader.size() + 1); } catch(const std::out_of_range &) { thrown = true; }
+  assert(thrown);
+
+  // Reader of a string
+  static constexpr auto str = "Only the requested characters are decrypted"_aes256;
+  AesReader<Aes256> string_reader{str};
+  char word[9]{};
+  assert(string_reader.read_at(9, std::span{reinterpret_cast<Byte *>(word), 9}) == 9);
+  assert(std::string_view(word, 9) == "requested");
+  assert(string_reader.tell() == 0);
+}
+
+void test_aes_string_table() {
+  static constexpr AesStringTable messages{"File not found", "", "Access denied", "The disk is full and no more data can be written"};
+  static_assert(messages.size() == 4);
+  static_assert(messages.pool_.size() == 15 + 1 + 14 + 49);
+  assert(messages.length(0) == 14 && messages.length(1) == 0 && messages.length(3) == 48);
+
+  // The pool is encrypted
+  assert(!std::equal(messages.pool_.begin(), messages.pool_.begin() + 14, "File not found"));
+
+  // One key schedule for all the entries
+  const auto context = messages.context();
+  assert(messages.decrypt(3, context) == "The disk is full and no more data can be written");
+  assert(messages.decrypt(0, context) == "File not found");
+  assert(messages.decrypt(1, context).empty());
+  assert(messages.decrypt(2) == "Access denied");
+
+  char buffer[7];
+  assert(messages.decrypt_to(2, buffer, context) == 7);
+  assert(std::string_view(buffer, 7) == "Access ");
+
+  const auto all = messages.decrypt_all();
+  assert(all.size() == 4 && all[0] == "File not found" && all[2] == "Access denied");
+
+  bool thrown = false;
+  try { (void)messages.decrypt(4); } catch(const std::out_of_range &) { thrown = true; }
+  assert(thrown);
+
+  static constexpr auto strong = make_aes_string_table<Aes256>("Secret", "Catalog");
+  static_assert(strong.ekey_.size() == 4 * (14 + 1));
+  // The key schedule is computed at compile-time and stored obfuscated
+  assert(strong.context().ekey() != strong.ekey_);
+  assert(strong.decrypt(1) == "Catalog");
+}
+
+void test_aes_batch() {
+  // Strings of different sizes (less than a block, several blocks, an exact number of blocks)
+  auto s1 = "Hello"_aes;
+  auto s2 = "A string long enough to span several counter blocks"_aes;
+  auto s3 = "0123456789abcde"_aes;
+  auto s4 = ""_aes;
+  decrypt_batch(s1, s2, s3, s4);
+  assert(std::string_view{static_cast<const char *>(s1)} == "Hello");
+  assert(std::string_view{static_cast<const char *>(s2)} == "A string long enough to span several counter blocks");
+  assert(std::string_view{static_cast<const char *>(s3)} == "0123456789abcde");
+  assert(std::string_view{static_cast<const char *>(s4)}.empty());
+  // Already decrypted strings are left unchanged
+  decrypt_batch(s1, s2);
+  assert(std::string_view{static_cast<const char *>(s1)} == "Hello");
+
+  // A range of strings, more than a group
+  std::array<AesString<5>, 11> strings{
+    "s-00", "s-01", "s-02", "s-03", "s-04", "s-05", "s-06", "s-07", "s-08", "s-09", "s-10"};
+  decrypt_batch(strings);
+  for(std::size_t i = 0; i < strings.size(); ++i)
+    assert(std::string_view{static_cast<const char *>(strings[i])} == std::string{"s-0"}.substr(0, i < 10 ? 3 : 2) + std::to_string(i));
+
+  // All the backends give the same result as the decryption of each stream
+  static constexpr Key k2 = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+  static constexpr Nonce n2 = {0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08};
+  const AesContext c1{fips_key}, c2{k2};
+  std::array<Byte, 700> a{};
+  std::array<Byte, 37> b{};
+  for(std::size_t i = 0; i < a.size(); ++i) a[i] = static_cast<Byte>(i);
+  for(std::size_t i = 0; i < b.size(); ++i) b[i] = static_cast<Byte>(3 * i);
+  auto expected_a = a;
+  auto expected_b = b;
+  decrypt_ctr(expected_a.data(), expected_a.size(), c1, ctr_nonce);
+  decrypt_ctr(expected_b.data(), expected_b.size(), c2, n2);
+
+  const auto check = [&]<AesBackend backend>() {
+    auto data_a = a;
+    auto data_b = b;
+    const CtrStream<> streams[] = {{data_a.data(), data_a.size(), &c1, &ctr_nonce}, {data_b.data(), data_b.size(), &c2, &n2}};
+    decrypt_ctr_batch<backend>(streams, 2);
+    assert(data_a == expected_a);
+    assert(data_b == expected_b);
+  };
+  for_each_aes_backend(check);
+}
+
+void test_aes_block_modes() {
+  // NIST SP 800-38A, F.1.1 (ECB-AES128) and F.2.1 (CBC-AES128)
+  static constexpr Block iv = {0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+  static constexpr std::array<Byte, 64> plain = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10};
+  static constexpr std::array<Byte, 64> ecb = {
+    0x3a, 0xd7, 0x7b, 0xb4, 0x0d, 0x7a, 0x36, 0x60, 0xa8, 0x9e, 0xca, 0xf3, 0x24, 0x66, 0xef, 0x97,
+    0xf5, 0xd3, 0xd5, 0x85, 0x03, 0xb9, 0x69, 0x9d, 0xe7, 0x85, 0x89, 0x5a, 0x96, 0xfd, 0xba, 0xaf,
+    0x43, 0xb1, 0xcd, 0x7f, 0x59, 0x8e, 0xce, 0x23, 0x88, 0x1b, 0x00, 0xe3, 0xed, 0x03, 0x06, 0x88,
+    0x7b, 0x0c, 0x78, 0x5e, 0x27, 0xe8, 0xad, 0x3f, 0x82, 0x23, 0x20, 0x71, 0x04, 0x72, 0x5d, 0xd4};
+  static constexpr std::array<Byte, 64> cbc = {
+    0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+    0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee, 0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+    0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b, 0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+    0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09, 0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7};
+  const AesContext context{fips_key};
+
+  // A larger buffer (a group of 256 blocks and a partial one) with an AES-256 key, encrypted block by block in CBC mode
+  const AesContext<Aes256> context256{Aes256::Key{
+    0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+    0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7, 0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4}};
+  std::array<Byte, 16 * 300> large_plain;
+  for(std::size_t i = 0; i < large_plain.size(); ++i) large_plain[i] = static_cast<Byte>(i * 7);
+  std::array<Byte, 16 * 300> large_cbc;
+  Block previous = iv;
+  for(std::size_t b = 0; b < 300; ++b) {
+    Block block;
+    for(std::size_t j = 0; j < 16; ++j) block[j] = large_plain[b * 16 + j] ^ previous[j];
+    previous = encrypt<AesBackend::REFERENCE>(block, context256);
+    std::copy(previous.begin(), previous.end(), large_cbc.begin() + b * 16);
+  }
+
+  const auto check = [&]<AesBackend backend>() {
+    auto data = ecb;
+    decrypt_blocks<backend>(data.data(), data.size(), context);
+    assert(data == plain);
+    std::copy(cbc.begin(), cbc.end(), data.begin());
+    decrypt_cbc<backend>(data.data(), data.size(), context, iv);
+    assert(data == plain);
+    // A partial last block is not decrypted
+    data = ecb;
+    decrypt_blocks<backend>(data.data(), 40, context);
+    assert(std::equal(data.begin(), data.begin() + 32, plain.begin()));
+    assert(std::equal(data.begin() + 32, data.end(), ecb.begin() + 32));
+
+    auto large = large_cbc;
+    decrypt_cbc<backend>(large.data(), large.size(), context256, iv);
+    assert(large == large_plain);
+  };
+  for_each_aes_backend(check);
+}
+
+void test_chacha20() {
+  // RFC 8439, 2.4.2: the first block (counter 0) is not used
+  static constexpr ChaChaKey key = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f};
+  static constexpr ChaChaNonce nonce = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x4a, 0x00, 0x00, 0x00, 0x00};
+  static constexpr std::string_view plain{
+    "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, sunscreen would be it."};
+  static constexpr std::array<Byte, 114> cipher = {
+    0x6e, 0x2e, 0x35, 0x9a, 0x25, 0x68, 0xf9, 0x80, 0x41, 0xba, 0x07, 0x28, 0xdd, 0x0d, 0x69, 0x81,
+    0xe9, 0x7e, 0x7a, 0xec, 0x1d, 0x43, 0x60, 0xc2, 0x0a, 0x27, 0xaf, 0xcc, 0xfd, 0x9f, 0xae, 0x0b,
+    0xf9, 0x1b, 0x65, 0xc5, 0x52, 0x47, 0x33, 0xab, 0x8f, 0x59, 0x3d, 0xab, 0xcd, 0x62, 0xb3, 0x57,
+    0x16, 0x39, 0xd6, 0x24, 0xe6, 0x51, 0x52, 0xab, 0x8f, 0x53, 0x0c, 0x35, 0x9f, 0x08, 0x61, 0xd8,
+    0x07, 0xca, 0x0d, 0xbf, 0x50, 0x0d, 0x6a, 0x61, 0x56, 0xa3, 0x8e, 0x08, 0x8a, 0x22, 0xb6, 0x5e,
+    0x52, 0xbc, 0x51, 0x4d, 0x16, 0xcc, 0xf8, 0x06, 0x81, 0x8c, 0xe9, 0x1a, 0xb7, 0x79, 0x37, 0x36,
+    0x5a, 0xf9, 0x0b, 0xbf, 0x74, 0xa3, 0x5b, 0xe6, 0xb4, 0x0b, 0x8e, 0xed, 0xf2, 0x78, 0x5e, 0x42,
+    0x87, 0x4d};
+
+  // Compile-time encryption
+  static constexpr auto encrypted = []() consteval {
+    std::array<Byte, 64 + 114> data{};
+    std::copy(plain.begin(), plain.end(), data.begin() + 64);
+    return encrypt_chacha20(data, key, nonce);
+  }();
+  static_assert(std::equal(cipher.begin(), cipher.end(), encrypted.begin() + 64));
+
+  // Runtime decryption, starting at the block 1
+  const auto check = [&]<ChaChaBackend backend>() {
+    auto data = cipher;
+    decrypt_chacha20<backend>(data.data(), data.size(), key, nonce, 64);
+    assert(std::equal(data.begin(), data.end(), plain.begin()));
+
+    // A large buffer (several groups of blocks and a partial block), from any position
+    std::vector<Byte> large(64 * 21 + 5), expected(large.size());
+    for(std::size_t i = 0; i < large.size(); ++i) large[i] = static_cast<Byte>(i * 3);
+    for(std::size_t offset : {0, 64, 13}) {
+      auto buffer = large;
+      expected = large;
+      decrypt_chacha20<ChaChaBackend::PORTABLE>(expected.data(), expected.size(), key, nonce, offset);
+      decrypt_chacha20<backend>(buffer.data(), buffer.size(), key, nonce, offset);
+      assert(buffer == expected);
+    }
+  };
+  for_each_chacha_backend(check);
+}
+
+void test_chacha_string() {
+  static constexpr auto s = "A string encrypted with ChaCha20, longer than a block of key stream (64 bytes)"_chacha;
+  static constexpr std::string_view expected{"A string encrypted with ChaCha20, longer than a block of key stream (64 bytes)"};
+  static_assert(s.size() == expected.size());
+  assert(std::string_view(s.raw(), s.size()) != expected);
+
+  assert(s.decrypt() == expected);
+  assert(s.decrypt_fixed() == expected);
+  char buffer[10];
+  assert(s.decrypt_to(buffer) == 10);
+  assert(std::string_view(buffer, 10) == "A string e");
+  assert(std::ranges::equal(s.view(), expected));
+
+  std::string chunks;
+  s.decrypt_chunks([&](std::string_view chunk) { chunks += chunk; });
+  assert(chunks == expected);
+  std::ostringstream os;
+  os << s;
+  assert(os.str() == expected);
+
+  auto t = "Hello"_chacha;
+  assert(std::string_view{static_cast<const char *>(t)} == "Hello");
+  assert(std::string_view{static_cast<const char *>(t)} == "Hello");
+}
+
+int triple(int x) { return 3 * x; }
+
+void test_fsm() {
+  static constexpr std::uint32_t value = 0xDEADBEEF;
+  static constexpr Fsm<int> fsm{value, 42};
+  assert(fsm.run(value) == 42);
+
+  // 4 states for each bit: the first one moves to the next bit, the 3 others are in a loop
+  int nb_active = 0;
+  for(int i = 0; i < 32; ++i) {
+    const bool bit = (value >> (31 - i)) & 1;
+    const auto next = fsm.find(4 * i, bit);
+    assert(next.to == 4 * i + 4);
+    if(next.o == 42) ++nb_active;
+    assert(fsm.find(4 * i, !bit).to == 4 * i + 1);
+    assert(fsm.find(4 * i + 1, 0).to == 4 * i + 2 && fsm.find(4 * i + 1, 1).to == 4 * i + 3);
+    assert(fsm.find(4 * i + 2, 0).to == 4 * i + 3 && fsm.find(4 * i + 2, 1).to == 4 * i + 1);
+    // The first transition added for the same state and input is used
+    assert(fsm.find(4 * i + 3, 0).to == 4 * i + 1);
+    bool thrown = false;
+    try { (void)fsm.find(4 * i + 3, 1); } catch(const std::exception &) { thrown = true; }
+    assert(thrown);
+  }
+  assert(nb_active == 1);
+
+  // Compact table, sized to the number of bits of the value
+  static constexpr std::uint32_t small = 0b1011;
+  static_assert(sizeof(Fsm<int, details::num_bits(small)>) < sizeof(fsm));
+  static_assert(sizeof(fsm.table_[0][0]) == 2);
+  // The active transition is always reached, even for short values
+  static constexpr Fsm<int, details::num_bits(small)> small_fsm{small, 42};
+  assert(small_fsm.run(small) == 42);
+  static constexpr Fsm<int, 1> one_bit_fsm{1, 42};
+  assert(one_bit_fsm.run(1) == 42);
+
+  // Calls stored statically
+  static constexpr auto random = call::generate_random(7);
+  assert((obfuscated_call<random, &triple>(random, 5) == 15));
+  assert((obfuscated_call<small, &triple>(small, 5) == 15));
+  assert((obfuscated_call<1000003, &triple>(1000003, 5) == 15));
+}
+
+// Object counting its decodings
+struct CountedDecoding {
+  void decode() noexcept { ++nb_decodings; decoded = true; }
+  int nb_decodings = 0;
+  bool decoded = false;
+};
+
+void test_fast_conversion() {
+  // Once the object is decoded, fast conversions skip the obfuscated call
+  static constexpr auto random = call::generate_random(11);
+  static CountedDecoding fast;
+  obfuscated_conversion<Conversion::FAST, random, &CountedDecoding::decode>(&fast, fast.decoded);
+  obfuscated_conversion<Conversion::FAST, random, &CountedDecoding::decode>(&fast, fast.decoded);
+  assert(fast.nb_decodings == 1);
+  // By default, each conversion runs the obfuscated call
+  static CountedDecoding obfuscated;
+  obfuscated_conversion<Conversion::OBFUSCATED, random, &CountedDecoding::decode>(&obfuscated, obfuscated.decoded);
+  obfuscated_conversion<Conversion::OBFUSCATED, random, &CountedDecoding::decode>(&obfuscated, obfuscated.decoded);
+  assert(obfuscated.nb_decodings == 2);
+
+  auto s = "Hello, world"_obf_fast;
+  static_assert(std::is_same_v<decltype(s), ObfuscatedString<13, Conversion::FAST>>);
+  const char *first = s;
+  const char *second = s;
+  assert(first == second && std::string_view{first} == "Hello, world");
+  std::ostringstream os;
+  os << s;
+  assert(os.str() == "Hello, world");
+
+  auto a = "Hello, AES"_aes_fast;
+  static_assert(std::is_same_v<decltype(a), AesString<11, Aes128, Conversion::FAST>>);
+  assert(std::string_view{static_cast<const char *>(a)} == "Hello, AES");
+  assert(std::string_view{static_cast<const char *>(a)} == "Hello, AES");
+
+  // Strings with both conversions decrypted in the same batch
+  auto b = "fast"_aes_fast;
+  auto c = "obfuscated"_aes;
+  decrypt_batch(b, c);
+  assert(std::string_view{static_cast<const char *>(b)} == "fast");
+  assert(std::string_view{static_cast<const char *>(c)} == "obfuscated");
+
+  auto h = "Hello, ChaCha"_chacha_fast;
+  static_assert(std::is_same_v<decltype(h), ChaChaString<14, Conversion::FAST>>);
+  assert(std::string_view{static_cast<const char *>(h)} == "Hello, ChaCha");
+  assert(std::string_view{static_cast<const char *>(h)} == "Hello, ChaCha");
+}
 
 int main() {
   test_strings_obfuscation();
   test_block_obfuscation();
+  test_key_schedule();
+  test_simd_decode();
+  test_partial_decode();
+  test_views();
+  test_decode_without_allocation();
+  test_output_by_chunks();
+  test_fsm();
   test_aes_key_expansion();
   test_aes_cipher();
   test_aes_ctr_cipher();
+  test_aes_context();
+  test_aes_backends();
+  test_aes_ni();
+  test_aes_bitsliced();
+  test_aes_policies();
+  test_aes_parallel();
+  test_aes_reader();
+  test_aes_string_table();
+  test_aes_batch();
+  test_aes_block_modes();
+  test_chacha20();
+  test_chacha_string();
+  test_fast_conversion();
   return 0;
 }